@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string>
+
+#include "../common/registry.hpp"
+#include "../common/pool.hpp"
+#include "../common/dense.hpp"
+
+#define COMPONENTS_PARALLEL_EDGES 4096  // edges per task at least
+
+// lock-free union-find: roots are always linked under the root with lower id,
+// so result doesn't depend on order in which threads process edges
+class ConcurrentDSU {
+private:
+    std::vector<std::atomic<uns long>> parents;
+
+public:
+    explicit ConcurrentDSU(size_t count) : parents(count) {
+        for (uns long i = 0; i < count; i++)
+            parents[i].store(i, std::memory_order_relaxed);
+    }
+
+    // path halving: every visited node is re-pointed to its grandparent
+    uns long find(uns long node) {
+        while (true) {
+            auto parent = parents[node].load(std::memory_order_relaxed);
+            if (parent == node)
+                return node;
+
+            auto grandparent = parents[parent].load(std::memory_order_relaxed);
+            if (grandparent != parent)
+                parents[node].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+
+            node = grandparent;
+        }
+    }
+
+    void unite(uns long a, uns long b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b)
+                return;
+
+            if (a < b)
+                std::swap(a, b);
+
+            // a could stop being a root in between, then retry from new roots
+            auto expected = a;
+            if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                return;
+        }
+    }
+};
+
+
+// searches from every unreached node in id order over out- and in-rows of the bit-matrix,
+// a row's new neighbours are found a word at a time
+std::vector<std::vector<uns long>> denseWeakComponents(const DenseGraph& dense) {
+    auto words = dense.rowWords();
+    std::vector<uint64_t> visited(words, 0);
+    std::vector<std::vector<uns long>> components;
+
+    for (uns long root = 0; root < dense.getNodesCount(); root++) {
+        if (visited[root >> 6] & (1ull << (root & 63)))
+            continue;
+
+        visited[root >> 6] |= 1ull << (root & 63);
+        components.emplace_back(1, root);
+        auto& component = components.back();
+
+        // component itself is the queue
+        for (size_t head = 0; head < component.size(); head++) {
+            auto out = dense.outRow(component[head]);
+            auto in = dense.inRow(component[head]);
+            for (size_t w = 0; w < words; w++) {
+                auto found = (out[w] | in[w]) & ~visited[w];
+                visited[w] |= found;
+                for (; found; found &= found - 1)
+                    component.push_back(w * 64 + __builtin_ctzll(found));
+            }
+        }
+
+        std::sort(component.begin(), component.end());
+    }
+
+    return components;
+}
+
+// groups of node ids, ordered by their lowest id, ids inside a group are ascending
+std::vector<std::vector<uns long>> weakComponents(Graph& graph) {
+    if (auto dense = dense_graphs.forGraph(graph))
+        return denseWeakComponents(*dense);
+
+    auto nodes_count = graph.getNodesCount();
+    auto edges_count = graph.getEdgesCount();
+    ConcurrentDSU dsu(nodes_count);
+
+    auto uniteRange = [&graph, &dsu] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            dsu.unite(graph.getEdge(i)->getSrc()->getId(), graph.getEdge(i)->getDrain()->getId());
+    };
+
+    thread_pool.parallelFor(0, edges_count, COMPONENTS_PARALLEL_EDGES, uniteRange);
+
+    // root is the lowest id of its component, so components appear in order of their roots
+    std::vector<std::vector<uns long>> components;
+    std::vector<long> component_of_root(nodes_count, -1);
+
+    for (uns long i = 0; i < nodes_count; i++) {
+        auto root = dsu.find(i);
+        if (component_of_root[root] == -1) {
+            component_of_root[root] = (long)components.size();
+            components.emplace_back();
+        }
+
+        components[component_of_root[root]].push_back(i);
+    }
+
+    return components;
+}
+
+// runs f(i, components[i]) for every component in parallel, components of uneven sizes are balanced
+// by stealing. f must only touch nodes of its own component
+template <class F>
+void forEachComponent(const std::vector<std::vector<uns long>>& components, F&& f) {
+    thread_pool.parallelFor(0, components.size(), 1, [&components, &f] (size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            f(i, components[i]);
+    });
+}
+
+
+// prints every weakly connected component on its own line. lines are formatted
+// per component on the pool, then written in order
+void Components(Graph& graph) {
+    auto components = weakComponents(graph);
+    std::vector<std::string> lines(components.size());
+
+    forEachComponent(components, [&graph, &lines] (size_t index, const std::vector<uns long>& component) {
+        for (auto i : component) {
+            lines[index] += MarkText(graph.getNode(i)->getMark()).view();
+            lines[index] += ' ';
+        }
+    });
+
+    for (auto& i : lines)
+        output << i << '\n';
+}
+
+inline void registerComponents(AlgorithmRegistry& registry) {
+    registry.add("COMPONENTS", 0, true, [] (Graph& graph, Node* const*) {
+        Components(graph);
+    });
+}
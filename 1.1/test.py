@@ -44,6 +44,7 @@ def generate_test_case(num_nodes, num_edges, weight_range=(1, 100), remove_prob=
     if nodes:
         root = random.choice(nodes)
         commands.append(f"RPO_NUMBERING {root}")
+    commands.append("COMPONENTS")
     
     return commands
 
@@ -165,6 +166,17 @@ class Validator:
                 output += " ".join(order[::-1]) + "\n"
                 continue
 
+            if splits[0] == "COMPONENTS":
+                splits.pop(0)
+
+                # program prints nodes in order they were added (their ids), components by their first node
+                order = {node: i for i, node in enumerate(self.graph.nodes)}
+                comps = [sorted(comp, key=order.get) for comp in nx.weakly_connected_components(self.graph)]
+                comps.sort(key=lambda comp: order[comp[0]])
+                for comp in comps:
+                    output += "".join(node + " " for node in comp) + "\n"
+                continue
+
             if splits[0] == "DIJKSTRA":
                 splits.pop(0)
                 src = splits[0]
@@ -1,20 +1,34 @@
+#pragma once
+
 #include <limits>
-#include "graph.hpp"
+#include "../common/registry.hpp"
+#include "../common/scratch.hpp"
+#include "../common/dense.hpp"
 
+// kept between queries, see scratch.hpp
+struct DijkstraScratch {
+    StampedArray<EDGE_WEIGHT_T> distances;
+    StampedArray<bool> visited;
+};
 
 void Dijkstra_path(Graph& graph, Node* root_node) {
     auto node_count = graph.getNodesCount();
 
-    // if distances are needed elsewhere, return it w/o freeing
-    auto distances = new std::vector<EDGE_WEIGHT_T>(node_count, std::numeric_limits<EDGE_WEIGHT_T>::max());
-    std::vector<bool> visited(node_count, false); // could be changed to bitset if large graphs are at use
+    auto& scratch = queryScratch<DijkstraScratch>();
+    auto& distances = scratch.distances;
+    auto& visited = scratch.visited;
+    distances.reset(node_count, std::numeric_limits<EDGE_WEIGHT_T>::max());
+    visited.reset(node_count, false);
+
+    distances.set(root_node->getId(), 0);
 
-    (*distances)[root_node->getId()] = 0;
+    // dense graphs relax a row of the weight matrix (see dense.hpp), parallel edges are merged in it
+    auto dense = dense_graphs.forGraph(graph);
 
     for (uns _ = 0; _ < node_count; _++) {
         long v = -1;
         for (uns u = 0; u < node_count; u++)
-            if (!visited[u] && (v==-1 || (*distances)[u] < (*distances)[v]))
+            if (!visited.get(u) && (v==-1 || distances.get(u) < distances.get(v)))
                 v = u;
 
         //
@@ -22,23 +36,39 @@ void Dijkstra_path(Graph& graph, Node* root_node) {
             break;
         }
 
-        visited[v] = true;
-        auto edges = graph.getNode(v)->getOutEdges();
+        visited.set(v, true);
+        if (dense) {
+            auto from = distances.get(v);
+            forEachBit(dense->outRow(v), dense->rowWords(), [&] (uns long i) {
+                distances.set(i, std::min(distances.get(i), from == std::numeric_limits<EDGE_WEIGHT_T>::max() ?
+                                                            std::numeric_limits<EDGE_WEIGHT_T>::max() : from + dense->weight(v, i)));
+            });
+            continue;
+        }
+
+        auto& edges = graph.getNode(v)->getOutEdges();
         
         // additional check on integer overflow needed
         for (auto e : edges)
-            (*distances)[e->getDrain()->getId()] = std::min((*distances)[e->getDrain()->getId()],
-                (*distances)[v] == std::numeric_limits<EDGE_WEIGHT_T>::max() ? std::numeric_limits<EDGE_WEIGHT_T>::max() : (*distances)[v] + e->getWeight());
+            distances.set(e->getDrain()->getId(), std::min(distances.get(e->getDrain()->getId()),
+                distances.get(v) == std::numeric_limits<EDGE_WEIGHT_T>::max() ? std::numeric_limits<EDGE_WEIGHT_T>::max() : distances.get(v) + e->getWeight()));
 
     }
 
     for (uns i = 0; i < node_count; i++) {
         if (i == root_node->getId()) continue;
 
-        std::cout << graph.getNode(i)->getMark() << " " <<
-        ((*distances)[i] == std::numeric_limits<EDGE_WEIGHT_T>::max() ? "inf" : std::to_string((*distances)[i])) <<
-        std::endl;
+        output << graph.getNode(i)->getMark() << " ";
+        if (distances.get(i) == std::numeric_limits<EDGE_WEIGHT_T>::max())
+            output << "inf";
+        else
+            output << distances.get(i);
+        output << '\n';
     }
+}
 
-    delete distances;
-}
\ No newline at end of file
+inline void registerDijkstra(AlgorithmRegistry& registry) {
+    registry.add("DIJKSTRA", 1, true, [] (Graph& graph, Node* const* nodes) {
+        Dijkstra_path(graph, nodes[0]);
+    });
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "../common/registry.hpp"
+#include "../common/pool.hpp"
+#include "../common/numa.hpp"
+#include "../common/scratch.hpp"
+#include "../common/dense.hpp"
+
+// direction-optimizing BFS (Beamer et al.): levels are expanded either top-down
+// from the frontier or bottom-up from unvisited nodes, whichever touches fewer edges.
+// frontiers are kept as bitmaps over node ids, every level is split into ranges of words
+// run by the thread pool
+
+#define BFS_ALPHA 14        // switch to bottom-up when frontier edges > unexplored edges / ALPHA
+#define BFS_BETA 24         // switch back to top-down when frontier nodes < nodes / BETA
+#define BFS_PARALLEL_WORDS 64  // bitmap words per level before it's split into tasks
+
+// reused by consecutive searches, so it's reset instead of reallocated
+struct BFS_Result {
+    // -1 means unreached
+    StampedArray<long> distances;
+    // parents are set for reached nodes only
+    std::vector<long> parents;
+    // arc through which node was reached, meaning is defined by traversal's Arcs
+    std::vector<long> parent_arcs;
+};
+
+// plain traversal over graph's edges, arc is edge id
+struct GraphArcs {
+    Graph& graph;
+
+    // callback returns true to stop scanning neighbours
+    template <class F>
+    void successors(uns long node, F&& f) {
+        for (auto i : graph.getNode(node)->getOutEdges())
+            if (f(i->getDrain()->getId(), (long)i->getId()))
+                return;
+    }
+
+    template <class F>
+    void predecessors(uns long node, F&& f) {
+        for (auto i : graph.getNode(node)->getInEdges())
+            if (f(i->getSrc()->getId(), (long)i->getId()))
+                return;
+    }
+
+    size_t degree(uns long node) {
+        return graph.getNode(node)->getOutEdges().size();
+    }
+
+    size_t arcsCount() {
+        return graph.getEdgesCount();
+    }
+};
+
+
+// splits [0, count) into ranges run by the pool; small counts are run inline
+template <class F>
+void parallelRanges(size_t count, F&& f) {
+    if (count < BFS_PARALLEL_WORDS) {
+        f(0, count);
+        return;
+    }
+
+    thread_pool.parallelFor(0, count, BFS_PARALLEL_WORDS / 2, f);
+}
+
+
+class BFS_Engine {
+private:
+    typedef NumaArray<std::atomic<uint64_t>> Bitmap;
+
+    // atomically sets the bit, returns true if it wasn't set before
+    static bool claim(Bitmap& bitmap, uns long node) {
+        uint64_t mask = 1ull << (node & 63);
+        return !(bitmap[node >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+
+    static bool test(const Bitmap& bitmap, uns long node) {
+        return bitmap[node >> 6].load(std::memory_order_relaxed) & (1ull << (node & 63));
+    }
+
+    static void clear(Bitmap& bitmap, size_t words) {
+        for (size_t i = 0; i < words; i++)
+            bitmap[i].store(0, std::memory_order_relaxed);
+    }
+
+    // bitmaps of the calling thread's searches, kept between queries (see scratch.hpp).
+    // they only grow, a search clears the words it uses. pages are first written by
+    // the ranges which scan them, so on NUMA machines they're local to their workers
+    struct Bitmaps {
+        Bitmap visited, frontier, next;
+
+        void fit(size_t words) {
+            if (visited.size() >= words)
+                return;
+
+            for (auto bitmap : {&visited, &frontier, &next}) {
+                bitmap->allocate(words, NumaPlacement::Local);
+                parallelRanges(words, [bitmap] (size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++)
+                        (*bitmap)[i].store(0, std::memory_order_relaxed);
+                });
+            }
+        }
+    };
+
+    // newly discovered nodes and their outgoing edges, ranges count their own and add them up once
+    struct LevelStats {
+        std::atomic<size_t> nodes{0};
+        std::atomic<size_t> edges{0};
+
+        void add(size_t found_nodes, size_t found_edges) {
+            nodes.fetch_add(found_nodes, std::memory_order_relaxed);
+            edges.fetch_add(found_edges, std::memory_order_relaxed);
+        }
+    };
+
+public:
+    // target >= 0 stops the search as soon as it's reached
+    template <class Arcs>
+    static void run(Arcs& arcs, size_t node_count, uns long root, BFS_Result& result, long target = -1) {
+        result.distances.reset(node_count, -1);
+        if (result.parents.size() < node_count) {
+            result.parents.resize(node_count);
+            result.parent_arcs.resize(node_count);
+        }
+        result.parents[root] = result.parent_arcs[root] = -1;
+
+        size_t words = (node_count + 63) / 64;
+        auto& bitmaps = queryScratch<Bitmaps>();
+        bitmaps.fit(words);
+        auto& visited = bitmaps.visited;
+        auto& frontier = bitmaps.frontier;
+        auto& next = bitmaps.next;
+        clear(visited, words);
+        clear(frontier, words);
+
+        claim(visited, root);
+        claim(frontier, root);
+        result.distances.set(root, 0);
+
+        size_t frontier_nodes = 1;
+        size_t frontier_edges = arcs.degree(root);
+        size_t unexplored_edges = arcs.arcsCount();
+        bool bottom_up = false;
+        long level = 0;
+
+        while (frontier_nodes > 0) {
+            if (target >= 0 && result.distances.get(target) != -1)
+                return;
+
+            if (!bottom_up && frontier_edges > unexplored_edges / BFS_ALPHA)
+                bottom_up = true;
+            else if (bottom_up && frontier_nodes < node_count / BFS_BETA)
+                bottom_up = false;
+
+            clear(next, words);
+            LevelStats stats;
+
+            auto discover = [&result, &next, level] (uns long node, uns long parent, long arc) {
+                result.distances.set(node, level + 1);
+                result.parents[node] = (long)parent;
+                result.parent_arcs[node] = arc;
+                claim(next, node);
+            };
+
+            if (!bottom_up)
+                parallelRanges(words, [&] (size_t begin, size_t end) {
+                    size_t found_nodes = 0, found_edges = 0;
+                    for (size_t w = begin; w < end; w++)
+                        for (uint64_t bits = frontier[w].load(std::memory_order_relaxed); bits; bits &= bits - 1) {
+                            uns long node = w * 64 + __builtin_ctzll(bits);
+
+                            arcs.successors(node, [&] (uns long succ, long arc) {
+                                if (!test(visited, succ) && claim(visited, succ)) {
+                                    discover(succ, node, arc);
+                                    found_nodes++;
+                                    found_edges += arcs.degree(succ);
+                                }
+                                return false;
+                            });
+                        }
+                    stats.add(found_nodes, found_edges);
+                });
+            else
+                // every range owns its words of visited and next, so no claims collide
+                parallelRanges(words, [&] (size_t begin, size_t end) {
+                    size_t found_nodes = 0, found_edges = 0;
+                    for (uns long node = begin * 64; node < std::min(node_count, end * 64); node++) {
+                        if (test(visited, node))
+                            continue;
+
+                        arcs.predecessors(node, [&] (uns long pred, long arc) {
+                            if (!test(frontier, pred))
+                                return false;
+
+                            claim(visited, node);
+                            discover(node, pred, arc);
+                            found_nodes++;
+                            found_edges += arcs.degree(node);
+                            return true;
+                        });
+                    }
+                    stats.add(found_nodes, found_edges);
+                });
+
+            unexplored_edges -= std::min(unexplored_edges, frontier_edges);
+            frontier_nodes = stats.nodes;
+            frontier_edges = stats.edges;
+
+            std::swap(frontier, next);
+            level++;
+        }
+    }
+};
+
+
+// bit rows of the calling thread's dense searches, kept between queries
+struct DenseBFS_Scratch {
+    std::vector<uint64_t> visited, frontier, next;
+    std::vector<uns long> frontier_nodes;
+};
+
+// BFS over the bit-matrix of a dense graph (see dense.hpp): a level is the union of the
+// frontier's out-rows minus visited nodes, or, once the frontier outgrows the unvisited part,
+// the unvisited nodes whose in-row meets the frontier. only distances are found
+void denseDistances(const DenseGraph& dense, uns long root, StampedArray<long>& distances) {
+    auto count = dense.getNodesCount();
+    auto words = dense.rowWords();
+    auto& scratch = queryScratch<DenseBFS_Scratch>();
+    auto& visited = scratch.visited;
+    auto& frontier = scratch.frontier;
+    auto& next = scratch.next;
+    auto& frontier_nodes = scratch.frontier_nodes;
+
+    distances.reset(count, -1);
+    visited.assign(words, 0);
+    frontier.assign(words, 0);
+    frontier_nodes.assign(1, root);
+
+    distances.set(root, 0);
+    visited[root >> 6] |= 1ull << (root & 63);
+    frontier[root >> 6] |= 1ull << (root & 63);
+    size_t reached = 1;
+
+    for (long level = 1; !frontier_nodes.empty(); level++) {
+        next.assign(words, 0);
+
+        if (frontier_nodes.size() <= count - reached) {
+            for (auto i : frontier_nodes)
+                orWords(next.data(), dense.outRow(i), words);
+            for (size_t w = 0; w < words; w++)
+                next[w] &= ~visited[w];
+        } else
+            for (uns long i = 0; i < count; i++)
+                if (!(visited[i >> 6] & (1ull << (i & 63))) && intersect(dense.inRow(i), frontier.data(), words))
+                    next[i >> 6] |= 1ull << (i & 63);
+
+        frontier_nodes.clear();
+        forEachBit(next.data(), words, [&] (uns long i) {
+            distances.set(i, level);
+            frontier_nodes.push_back(i);
+        });
+        for (size_t w = 0; w < words; w++)
+            visited[w] |= next[w];
+        reached += frontier_nodes.size();
+        std::swap(frontier, next);
+    }
+}
+
+// prints hop distance from root to every other node
+void BFS_Distances(Graph& graph, Node* root_node) {
+    auto& result = queryScratch<BFS_Result>();
+
+    if (auto dense = dense_graphs.forGraph(graph))
+        denseDistances(*dense, root_node->getId(), result.distances);
+    else {
+        GraphArcs arcs{graph};
+        BFS_Engine::run(arcs, graph.getNodesCount(), root_node->getId(), result);
+    }
+
+    for (uns i = 0; i < graph.getNodesCount(); i++) {
+        if (i == root_node->getId()) continue;
+
+        output << graph.getNode(i)->getMark() << " ";
+        if (result.distances.get(i) == -1)
+            output << "inf";
+        else
+            output << result.distances.get(i);
+        output << '\n';
+    }
+}
+
+inline void registerBFS(AlgorithmRegistry& registry) {
+    registry.add("BFS", 1, true, [] (Graph& graph, Node* const* nodes) {
+        BFS_Distances(graph, nodes[0]);
+    });
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "max_flow.hpp"
+#include "../common/versions.hpp"
+
+// what-if scenarios for MAX FLOW: FORK <name> forks the current graph, IN <name> <command>
+// runs EDGE, REMOVE EDGE or MAX FLOW on the fork instead of the graph, DROP <name> forgets it.
+// a fork keeps only its scenario's changes (see FlowOverlay) over a base which is only read,
+// and forks taken at the same version share one base. so a scenario costs as much as the edges
+// it touches, and MAX FLOWs of different forks run at once (e.g. on server's workers).
+// a version the server pinned for the line is the base itself, elsewhere the graph is changed
+// in place by later lines, so the base is a copy, made once per version
+
+class FlowForks {
+private:
+    struct Fork {
+        std::shared_ptr<Graph> base;
+        FlowOverlay overlay;
+        std::shared_mutex mutex;    // scenario is changed exclusively, flows are computed under a shared lock
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<Fork>> forks;
+
+    std::mutex base_mutex;
+    std::weak_ptr<Graph> last_base;     // reused while the graph stays the same and a fork holds it
+
+    std::shared_ptr<Graph> baseOf(Graph& graph) {
+        if (line_version<Graph>.get() == &graph)
+            return line_version<Graph>;
+
+        std::unique_lock<std::mutex> lock(base_mutex);
+        auto base = last_base.lock();
+        if (!base || base->getVersion() != graph.getVersion()) {
+            base = graph.clone();
+            last_base = base;
+        }
+        return base;
+    }
+
+    std::shared_ptr<Fork> find(std::string_view name) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto fork = forks.find(std::string(name));
+        return fork == forks.end() ? nullptr : fork->second;
+    }
+
+    // reported the way the graph's commands do
+    static bool findNodes(Graph& graph, std::string_view src_name, std::string_view drain_name, Node*& src, Node*& drain) {
+        src = graph.getNode(src_name);
+        drain = graph.getNode(drain_name);
+
+        if (!src && !drain)
+            output << "Unknown nodes " << src_name << " " << drain_name << '\n';
+        else if (!src)
+            output << "Unknown node " << src_name << '\n';
+        else if (!drain)
+            output << "Unknown node " << drain_name << '\n';
+        return src && drain;
+    }
+
+    static void addEdge(Fork& fork, Node* src, Node* drain, EDGE_WEIGHT_T weight) {
+        auto id = fork.base->getEdgesCount() + fork.overlay.edges.size();
+        fork.overlay.edges.push_back({src->getId(), drain->getId(), weight});
+        fork.overlay.out[src->getId()].push_back(id);
+        fork.overlay.in[drain->getId()].push_back(id);
+    }
+
+    // as in the graph, the edge with the lowest id goes: base's first, then the fork's own
+    static bool removeEdge(Fork& fork, Node* src, Node* drain) {
+        auto& removed = fork.overlay.removed;
+
+        for (auto i : src->getOutEdges())
+            if (i->getDrain() == drain && !removed.count(i->getId())) {
+                removed.insert(i->getId());
+                return true;
+            }
+
+        auto out = fork.overlay.out.find(src->getId());
+        if (out != fork.overlay.out.end())
+            for (auto i : out->second)
+                if (fork.overlay.edges[i - fork.base->getEdgesCount()].drain == drain->getId() && !removed.count(i)) {
+                    removed.insert(i);
+                    return true;
+                }
+
+        output << "Unknown edge " << src->getMark() << " " << drain->getMark() << '\n';
+        return false;
+    }
+
+public:
+    // replaces the fork if there's one with this name
+    void fork(Graph& graph, std::string_view name) {
+        auto created = std::make_shared<Fork>();
+        created->base = baseOf(graph);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        forks[std::string(name)].swap(created);
+    }
+
+    bool drop(std::string_view name) {
+        std::shared_ptr<Fork> dropped;  // freed after the lock is released
+
+        std::unique_lock<std::mutex> lock(mutex);
+        auto fork = forks.find(std::string(name));
+        if (fork == forks.end())
+            return false;
+
+        dropped = std::move(fork->second);
+        forks.erase(fork);
+        return true;
+    }
+
+    // IN's arguments: fork's name and the command, which is run if execute is set
+    void in(Tokenizer& request, bool execute) {
+        auto name = request.front();
+        request.pop();
+        auto command = request.front();
+        request.pop();
+
+        size_t count = 0;
+        if (command == "EDGE")
+            count = 3;
+        else if ((command == "REMOVE" && request.front() == "EDGE") || (command == "MAX" && request.front() == "FLOW")) {
+            command = command == "MAX" ? "MAX FLOW" : "REMOVE EDGE";
+            request.pop();
+            count = 2;
+        }
+
+        std::string_view arguments[3];
+        for (size_t i = 0; i < count; i++) {
+            arguments[i] = request.front();
+            request.pop();
+        }
+
+        // an unsupported command's arguments aren't known, the rest of the line is dropped
+        // so that none of it runs on the graph
+        if (!count)
+            while (!request.empty())
+                request.pop();
+
+        if (!execute)
+            return;
+
+        if (!count) {
+            output << "Unsupported in forks " << command << '\n';
+            return;
+        }
+
+        auto fork = find(name);
+        if (!fork) {
+            output << "Unknown fork " << name << '\n';
+            return;
+        }
+
+        EDGE_WEIGHT_T weight;
+        if (command == "EDGE" && !parseNumber(arguments[2], weight)) {
+            output << "Invalid weight " << arguments[2] << '\n';
+            return;
+        }
+
+        Node* src;
+        Node* drain;
+        if (!findNodes(*fork->base, arguments[0], arguments[1], src, drain))
+            return;
+
+        if (command == "MAX FLOW") {
+            std::shared_lock<std::shared_mutex> lock(fork->mutex);
+            output << maxFlow(*fork->base, src, drain, fork->overlay) << '\n';
+            return;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(fork->mutex);
+        if (command == "EDGE")
+            addEdge(*fork, src, drain, weight);
+        else
+            removeEdge(*fork, src, drain);
+    }
+};
+
+// shared by everything in the process
+inline FlowForks flow_forks;
+
+inline void registerFlowForks(AlgorithmRegistry& registry) {
+    registry.addParsed("FORK", [] (Graph* graph, Tokenizer& request) {
+        auto name = request.front();
+        request.pop();
+        if (graph)
+            flow_forks.fork(*graph, name);
+    });
+
+    registry.addParsed("DROP", [] (Graph* graph, Tokenizer& request) {
+        auto name = request.front();
+        request.pop();
+        if (graph && !flow_forks.drop(name))
+            output << "Unknown fork " << name << '\n';
+    });
+
+    registry.addParsed("IN", [] (Graph* graph, Tokenizer& request) {
+        flow_forks.in(request, graph != nullptr);
+    });
+}
@@ -1,68 +1,180 @@
-#include "graph.hpp"
-
-std::vector<Edge*>* findPath(Graph& graph, Node* src, Node* drain, std::vector<EDGE_WEIGHT_T>& flow) {
-    std::queue<Node*> Q;
-    std::vector<Edge*> parents(graph.getNodesCount(), nullptr); // to backtrack the path
-    std::vector<bool> visited(graph.getNodesCount(), false);
-    visited[src->getId()] = true;
-
-    Q.push(src);
-    while (!Q.empty()) {
-        auto curr_node = Q.front();
-        Q.pop();
-
-        // found drain
-        if (curr_node == drain) {
-            auto path = new std::vector<Edge*>;
-            auto iter = curr_node;
-
-            while (parents[iter->getId()]) {
-                path->push_back(parents[iter->getId()]);
-                iter = parents[iter->getId()]->getSrc();
-            }
+#pragma once
 
-            return path;
-        }
+#include <unordered_map>
+#include <unordered_set>
 
-        for (auto i : curr_node->getOutEdges())
-            if (!visited[i->getDrain()->getId()] && flow[i->getId()] > 0) {
-                visited[i->getDrain()->getId()] = true;
-                parents[i->getDrain()->getId()] = i;
+#include "bfs.hpp"
 
-                Q.push(i->getDrain());
-            }
+// changes a what-if scenario makes to the graph (see flow_forks.hpp): new edges get ids
+// from graph's edges count on, removed ones (graph's or new) are listed by id.
+// the graph itself isn't touched, a removed edge just has no capacity
+struct FlowOverlay {
+    std::vector<Graph::DeltaEdge> edges;
+    std::unordered_map<uns long, std::vector<uns long>> out;    // node id -> new edges' ids
+    std::unordered_map<uns long, std::vector<uns long>> in;
+    std::unordered_set<uns long> removed;
+
+    bool empty() const {
+        return edges.empty() && removed.empty();
     }
+};
+
+// residual network of the graph: edge's remaining capacity forwards,
+// already pushed flow backwards (arc -(id + 1)) so that it could be cancelled
+struct ResidualArcs {
+    Graph& graph;
+    std::vector<EDGE_WEIGHT_T>& flow;
+    std::vector<EDGE_WEIGHT_T>& resulting_flow;
+    const FlowOverlay& overlay;
+
+    // new edges of the overlay at node, ids are passed to f
+    template <class F>
+    bool overlayEdges(const std::unordered_map<uns long, std::vector<uns long>>& edges, uns long node, F&& f) {
+        if (edges.empty())
+            return false;
+
+        auto found = edges.find(node);
+        if (found != edges.end())
+            for (auto i : found->second)
+                if (f(i))
+                    return true;
+        return false;
+    }
+
+    uns long overlaySrc(uns long id) {
+        return overlay.edges[id - graph.getEdgesCount()].src;
+    }
+
+    uns long overlayDrain(uns long id) {
+        return overlay.edges[id - graph.getEdgesCount()].drain;
+    }
+
+    template <class F>
+    void successors(uns long node, F&& f) {
+        for (auto i : graph.getNode(node)->getOutEdges())
+            if (flow[i->getId()] > 0 && f(i->getDrain()->getId(), (long)i->getId()))
+                return;
+        if (overlayEdges(overlay.out, node, [this, &f] (uns long i) {
+            return flow[i] > 0 && f(overlayDrain(i), (long)i);
+        }))
+            return;
+
+        for (auto i : graph.getNode(node)->getInEdges())
+            if (resulting_flow[i->getId()] > 0 && f(i->getSrc()->getId(), -(long)i->getId() - 1))
+                return;
+        overlayEdges(overlay.in, node, [this, &f] (uns long i) {
+            return resulting_flow[i] > 0 && f(overlaySrc(i), -(long)i - 1);
+        });
+    }
+
+    template <class F>
+    void predecessors(uns long node, F&& f) {
+        for (auto i : graph.getNode(node)->getInEdges())
+            if (flow[i->getId()] > 0 && f(i->getSrc()->getId(), (long)i->getId()))
+                return;
+        if (overlayEdges(overlay.in, node, [this, &f] (uns long i) {
+            return flow[i] > 0 && f(overlaySrc(i), (long)i);
+        }))
+            return;
+
+        for (auto i : graph.getNode(node)->getOutEdges())
+            if (resulting_flow[i->getId()] > 0 && f(i->getDrain()->getId(), -(long)i->getId() - 1))
+                return;
+        overlayEdges(overlay.out, node, [this, &f] (uns long i) {
+            return resulting_flow[i] > 0 && f(overlayDrain(i), -(long)i - 1);
+        });
+    }
+
+    size_t degree(uns long node) {
+        size_t extra = 0;
+        overlayEdges(overlay.out, node, [&extra] (uns long) { extra++; return false; });
+        overlayEdges(overlay.in, node, [&extra] (uns long) { extra++; return false; });
+        return graph.getNode(node)->getOutEdges().size() + graph.getNode(node)->getInEdges().size() + extra;
+    }
+
+    size_t arcsCount() {
+        return 2 * (graph.getEdgesCount() + overlay.edges.size());
+    }
+};
+
+// kept between queries, see scratch.hpp. flows are rewritten by every query
+// (capacities aren't uniform), but their buffers are reused
+struct MaxFlowScratch {
+    std::vector<EDGE_WEIGHT_T> flow;
+    std::vector<EDGE_WEIGHT_T> resulting_flow;
+    BFS_Result search;
+    std::vector<long> path;
+};
+
+// puts arcs of the shortest augmenting path from drain back to src into path,
+// returns false if there's none
+bool findPath(Graph& graph, Node* src, Node* drain, ResidualArcs& arcs, BFS_Result& result, std::vector<long>& path) {
+    if (src == drain)
+        return false;
+
+    BFS_Engine::run(arcs, graph.getNodesCount(), src->getId(), result, (long)drain->getId());
 
     // path not found
-    return nullptr;
+    if (result.distances.get(drain->getId()) == -1)
+        return false;
+
+    path.clear();
+    for (long iter = (long)drain->getId(); iter != (long)src->getId(); iter = result.parents[iter])
+        path.push_back(result.parent_arcs[iter]);
+
+    return true;
 }
 
-EDGE_WEIGHT_T maxFlow(Graph& graph, Node* src, Node* drain) {
-    std::vector<EDGE_WEIGHT_T> flow(graph.getEdgesCount());
-    std::vector<EDGE_WEIGHT_T> resulting_flow(graph.getEdgesCount(), 0);
+// overlay's scenario is applied on top of the graph
+EDGE_WEIGHT_T maxFlow(Graph& graph, Node* src, Node* drain, const FlowOverlay& overlay = FlowOverlay()) {
+    auto& scratch = queryScratch<MaxFlowScratch>();
+    auto& flow = scratch.flow;
+    auto& resulting_flow = scratch.resulting_flow;
+    auto& path = scratch.path;
+
+    size_t edges_count = graph.getEdgesCount() + overlay.edges.size();
+    flow.resize(edges_count);
+    resulting_flow.assign(edges_count, 0);
 
     for (uns i = 0; i < graph.getEdgesCount(); i++)
         flow[i] = graph.getEdge(i)->getWeight();
+    for (size_t i = 0; i < overlay.edges.size(); i++)
+        flow[graph.getEdgesCount() + i] = overlay.edges[i].weight;
+    for (auto i : overlay.removed)
+        flow[i] = 0;
 
-    auto path = findPath(graph, src, drain, flow);
-    while (path) {
-        EDGE_WEIGHT_T min_pathFlow = (*path)[0]->getWeight();
-        for (auto i : *path)
-            min_pathFlow = std::min(min_pathFlow, flow[i->getId()]);
+    ResidualArcs arcs{graph, flow, resulting_flow, overlay};
 
-        for (auto i : *path) {
-            flow[i->getId()] -= std::max(min_pathFlow, (EDGE_WEIGHT_T&&)0);
-            resulting_flow[i->getId()] += min_pathFlow;
-        }
+    while (findPath(graph, src, drain, arcs, scratch.search, path)) {
+        EDGE_WEIGHT_T min_pathFlow = std::numeric_limits<EDGE_WEIGHT_T>::max();
+        for (auto i : path)
+            min_pathFlow = std::min(min_pathFlow, i >= 0 ? flow[i] : resulting_flow[-i - 1]);
 
-        delete path;
-        path = findPath(graph, src, drain, flow);
+        for (auto i : path) {
+            if (i >= 0) {
+                flow[i] -= min_pathFlow;
+                resulting_flow[i] += min_pathFlow;
+            } else {
+                resulting_flow[-i - 1] -= min_pathFlow;
+                flow[-i - 1] += min_pathFlow;
+            }
+        }
     }
 
-    // total flow could be measured by resulting flow of outgoing source edges
+    // total flow could be measured by resulting flow of outgoing source edges minus returning one
     EDGE_WEIGHT_T total_flow = 0;
     for (auto i : src->getOutEdges())
         total_flow += resulting_flow[i->getId()];
+    for (auto i : src->getInEdges())
+        total_flow -= resulting_flow[i->getId()];
+    arcs.overlayEdges(overlay.out, src->getId(), [&] (uns long i) { total_flow += resulting_flow[i]; return false; });
+    arcs.overlayEdges(overlay.in, src->getId(), [&] (uns long i) { total_flow -= resulting_flow[i]; return false; });
 
     return total_flow;
 }
+
+inline void registerMaxFlow(AlgorithmRegistry& registry) {
+    registry.add("MAX FLOW", 2, true, [] (Graph& graph, Node* const* nodes) {
+        output << maxFlow(graph, nodes[0], nodes[1]) << '\n';
+    });
+}
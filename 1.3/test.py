@@ -45,6 +45,10 @@ def generate_test_case(num_nodes, num_edges, weight_range=(1, 100), remove_prob=
         src, drain = random.sample(nodes, 2)
         
         commands.append(f"MAX FLOW {src} {drain}")
+
+        # hop distances, from a root which reaches most of the graph and a random one
+        commands.append(f"BFS {max(nodes, key=lambda node: sum(1 for a, b, w in edges if a == node))}")
+        commands.append(f"BFS {random.choice(nodes)}")
     
     return commands
 
@@ -183,7 +187,23 @@ class Validator:
                         output += f"{drain_node} inf\n" # no path found
                 
                 continue
-                    
+
+            if splits[0] == "BFS":
+                splits.pop(0)
+                src = splits[0]
+                splits.pop(0)
+                if src not in self.node_labels:
+                    output += f"Unknown node {src}\n"
+                    continue
+
+                hops = nx.single_source_shortest_path_length(self.graph, src)
+                for drain_node in self.graph.nodes:
+                    if drain_node == src:
+                        continue
+                    output += f"{drain_node} {hops.get(drain_node, 'inf')}\n"
+
+                continue
+
             if splits[0] == "MAX":
                 splits.pop(0)
                 splits.pop(0)
@@ -277,6 +297,16 @@ def generate_files():
     write_file("tests/test_big.txt", big_test)
     generated_files += ["tests/test_big.txt"]
 
+    # wide frontiers make BFS go bottom-up, and with nodes^2 / 8 edges
+    # the graph is kept as a bit matrix (common/dense.hpp)
+    dense_test = generate_test_case(
+        num_nodes=80,
+        num_edges=1600,
+        remove_prob=0.01
+    )
+    write_file("tests/test_dense.txt", dense_test)
+    generated_files += ["tests/test_dense.txt"]
+
     return generated_files
 
 
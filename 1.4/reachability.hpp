@@ -0,0 +1,352 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <mutex>
+#include <memory>
+
+#include "tarjan.hpp"
+
+// bitset closure is used while it fits, interval labels otherwise.
+// tests build with -DREACH_BITSET_LIMIT=0 to check the interval mode on small graphs
+#ifndef REACH_BITSET_LIMIT
+#define REACH_BITSET_LIMIT (256ul << 20)  // bytes
+#endif
+#define REACH_LABELLINGS 3                // interval labels per component
+
+// answers "can a reach b" queries. SCCs are condensed into a DAG, then either
+// the transitive closure is stored as a bit row per component and a query is one bit lookup,
+// or (for large graphs) every component gets REACH_LABELLINGS interval labels. a query
+// which any of them rules out is answered at once, the rest search the condensation
+// (pruned by the labels), so in this mode queries aren't O(1); REACH_INDEX tells how many searched.
+// describes one version of the graph and isn't changed once built (see ReachabilityIndexes)
+class ReachabilityIndex {
+private:
+    uint64_t version = 0;   // graph's version the index describes
+    bool intervals = false;
+
+    // node id -> component id, components are numbered in reverse topological order
+    std::vector<uns long> component;
+    size_t components_count = 0;
+    std::vector<std::vector<uns long>> successors;
+
+    // closure row of component c starts at c * row_words
+    std::vector<uint64_t> closure;
+    size_t row_words = 0;
+
+    // interval labels: postorder number and minimal postorder among reachable components,
+    // labelling l of component c is at c * REACH_LABELLINGS + l
+    std::vector<uns long> post;
+    std::vector<uns long> low;
+
+    // interval mode only, queries and searches they needed
+    mutable std::atomic<uint64_t> queries{0};
+    mutable std::atomic<uint64_t> searches{0};
+
+    // kept between queries, see scratch.hpp
+    struct SearchScratch {
+        StampedArray<bool> visited;
+        std::vector<uns long> stack;
+    };
+
+    // iterative Tarjan over all nodes, recursion would overflow on long paths
+    void condense(Graph& graph) {
+        auto count = graph.getNodesCount();
+        const uns long undefined = std::numeric_limits<uns long>::max();
+
+        std::vector<uns long> indexes(count, undefined);
+        std::vector<uns long> lowlink_indexes(count, 0);
+        std::vector<bool> isOnStack(count, false);
+        std::vector<uns long> SCC_Stack;
+        std::vector<std::pair<uns long, EdgeSet::iterator>> DFS_Stack;
+        uns long curr_index = 0;
+
+        component.assign(count, undefined);
+        components_count = 0;
+
+        for (uns long root = 0; root < count; root++) {
+            if (indexes[root] != undefined)
+                continue;
+
+            DFS_Stack.emplace_back(root, graph.getNode(root)->getOutEdges().begin());
+            indexes[root] = lowlink_indexes[root] = curr_index++;
+            SCC_Stack.push_back(root);
+            isOnStack[root] = true;
+
+            while (!DFS_Stack.empty()) {
+                auto node = DFS_Stack.back().first;
+                auto& iter = DFS_Stack.back().second;
+
+                if (iter != graph.getNode(node)->getOutEdges().end()) {
+                    auto succ = (*iter)->getDrain()->getId();
+                    iter++;
+
+                    if (indexes[succ] == undefined) {
+                        DFS_Stack.emplace_back(succ, graph.getNode(succ)->getOutEdges().begin());
+                        indexes[succ] = lowlink_indexes[succ] = curr_index++;
+                        SCC_Stack.push_back(succ);
+                        isOnStack[succ] = true;
+                    } else if (isOnStack[succ])
+                        lowlink_indexes[node] = std::min(lowlink_indexes[node], indexes[succ]);
+
+                    continue;
+                }
+
+                // node is finished
+                DFS_Stack.pop_back();
+                if (!DFS_Stack.empty()) {
+                    auto parent = DFS_Stack.back().first;
+                    lowlink_indexes[parent] = std::min(lowlink_indexes[parent], lowlink_indexes[node]);
+                }
+
+                if (lowlink_indexes[node] == indexes[node]) {
+                    uns long member;
+                    do {
+                        member = SCC_Stack.back();
+                        SCC_Stack.pop_back();
+                        isOnStack[member] = false;
+                        component[member] = components_count;
+                    } while (member != node);
+
+                    components_count++;
+                }
+            }
+        }
+
+        // condensation DAG, every edge leads to a component with lower id
+        successors.assign(components_count, {});
+        for (uns long i = 0; i < count; i++)
+            for (auto e : graph.getNode(i)->getOutEdges()) {
+                auto target = component[e->getDrain()->getId()];
+                if (target != component[i])
+                    successors[component[i]].push_back(target);
+            }
+
+        for (auto& i : successors) {
+            std::sort(i.begin(), i.end());
+            i.erase(std::unique(i.begin(), i.end()), i.end());
+        }
+    }
+
+    // successors are numbered lower, so their rows are complete by the time they're merged
+    void buildClosure() {
+        row_words = (components_count + 63) / 64;
+        closure.assign(components_count * row_words, 0);
+
+        for (uns long c = 0; c < components_count; c++) {
+            uint64_t* row = &closure[c * row_words];
+            row[c >> 6] |= 1ull << (c & 63);
+
+            for (auto s : successors[c]) {
+                const uint64_t* succ_row = &closure[s * row_words];
+                for (size_t w = 0; w < row_words; w++)
+                    row[w] |= succ_row[w];
+            }
+        }
+    }
+
+    // postorder of a DFS over the condensation, every component is numbered after its successors
+    void labelByDFS(size_t labelling, const std::vector<uns long>& roots) {
+        std::vector<bool> visited(components_count, false);
+        std::vector<std::pair<uns long, size_t>> DFS_Stack;
+        uns long counter = 0;
+
+        for (auto root : roots) {
+            if (visited[root])
+                continue;
+
+            visited[root] = true;
+            DFS_Stack.emplace_back(root, 0);
+            while (!DFS_Stack.empty()) {
+                auto c = DFS_Stack.back().first;
+                auto next = DFS_Stack.back().second++;
+
+                if (next < successors[c].size()) {
+                    auto s = successors[c][next];
+                    if (!visited[s]) {
+                        visited[s] = true;
+                        DFS_Stack.emplace_back(s, 0);
+                    }
+                    continue;
+                }
+
+                DFS_Stack.pop_back();
+                auto label = c * REACH_LABELLINGS + labelling;
+                post[label] = low[label] = counter++;
+                for (auto s : successors[c])
+                    low[label] = std::min(low[label], low[s * REACH_LABELLINGS + labelling]);
+            }
+        }
+    }
+
+    // the first labelling is the reverse topological order components already have, the others
+    // come from DFS with roots and successors shuffled: a pair one labelling can't rule out
+    // is often ruled out by another
+    void buildIntervals() {
+        post.assign(components_count * REACH_LABELLINGS, 0);
+        low.assign(components_count * REACH_LABELLINGS, 0);
+
+        for (uns long c = 0; c < components_count; c++) {
+            auto label = c * REACH_LABELLINGS;
+            post[label] = low[label] = c;
+            for (auto s : successors[c])
+                low[label] = std::min(low[label], low[s * REACH_LABELLINGS]);
+        }
+
+        std::mt19937 rng(components_count);
+        std::vector<uns long> roots(components_count);
+        for (uns long c = 0; c < components_count; c++)
+            roots[c] = c;
+
+        for (size_t l = 1; l < REACH_LABELLINGS; l++) {
+            std::shuffle(roots.begin(), roots.end(), rng);
+            for (auto& i : successors)
+                std::shuffle(i.begin(), i.end(), rng);
+            labelByDFS(l, roots);
+        }
+    }
+
+    bool mayReach(uns long from, uns long to) const {
+        for (size_t l = 0; l < REACH_LABELLINGS; l++) {
+            auto a = from * REACH_LABELLINGS + l;
+            auto b = to * REACH_LABELLINGS + l;
+            if (post[b] < low[a] || post[a] < post[b])
+                return false;
+        }
+        return true;
+    }
+
+    // DFS over the condensation, pruned by interval labels
+    bool search(uns long from, uns long to) const {
+        auto& scratch = queryScratch<SearchScratch>();
+        scratch.visited.reset(components_count, false);
+        scratch.stack.clear();
+        scratch.stack.push_back(from);
+        scratch.visited.set(from, true);
+
+        while (!scratch.stack.empty()) {
+            auto curr = scratch.stack.back();
+            scratch.stack.pop_back();
+
+            if (curr == to)
+                return true;
+
+            for (auto s : successors[curr])
+                if (!scratch.visited.get(s) && mayReach(s, to)) {
+                    scratch.visited.set(s, true);
+                    scratch.stack.push_back(s);
+                }
+        }
+
+        return false;
+    }
+
+public:
+    void build(Graph& graph) {
+        condense(graph);
+
+        intervals = components_count * ((components_count + 63) / 64) * sizeof(uint64_t) > REACH_BITSET_LIMIT;
+        std::vector<uint64_t>().swap(closure);
+        std::vector<uns long>().swap(post);
+        std::vector<uns long>().swap(low);
+
+        if (intervals)
+            buildIntervals();
+        else
+            buildClosure();
+
+        version = graph.getVersion();
+    }
+
+    uint64_t getVersion() const {
+        return version;
+    }
+
+    bool reaches(Node* src, Node* drain) const {
+        auto from = component[src->getId()];
+        auto to = component[drain->getId()];
+
+        if (!intervals)
+            return closure[from * row_words + (to >> 6)] & (1ull << (to & 63));
+
+        queries++;
+        if (from == to)
+            return true;
+        if (!mayReach(from, to))
+            return false;
+
+        searches++;
+        return search(from, to);
+    }
+
+    // bytes held by the index
+    size_t memoryCost() const {
+        size_t total = component.capacity() * sizeof(uns long);
+        total += closure.capacity() * sizeof(uint64_t);
+        total += (post.capacity() + low.capacity()) * sizeof(uns long);
+
+        for (auto& i : successors)
+            total += i.capacity() * sizeof(uns long) + sizeof(i);
+
+        return total;
+    }
+
+    void printStats() const {
+        output << (intervals ? "intervals" : "bitset") << " components " << components_count <<
+        " bytes " << memoryCost();
+        if (intervals)
+            output << " labellings " << REACH_LABELLINGS << ", " << searches.load() << " of " << queries.load() <<
+            " queries searched the condensation (not O(1))";
+        output << '\n';
+    }
+};
+
+// index of the latest graph version queried, built lazily: a query after a mutation rebuilds it.
+// queries may run concurrently (server mode), the first of them builds the index, the rest wait.
+// a query keeps the index it got, even if a query on a newer version replaces it meanwhile;
+// queries on an older version (pinned by the server) get an index of their own
+class ReachabilityIndexes {
+private:
+    std::mutex mutex;
+    std::mutex build_mutex;
+    std::shared_ptr<const ReachabilityIndex> latest;
+
+    std::shared_ptr<const ReachabilityIndex> find(uint64_t version) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (latest && latest->getVersion() == version)
+            return latest;
+        return nullptr;
+    }
+
+public:
+    std::shared_ptr<const ReachabilityIndex> forGraph(Graph& graph) {
+        if (auto index = find(graph.getVersion()))
+            return index;
+
+        std::unique_lock<std::mutex> build_lock(build_mutex);
+        if (auto index = find(graph.getVersion()))
+            return index;
+
+        auto index = std::make_shared<ReachabilityIndex>();
+        index->build(graph);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!latest || latest->getVersion() < index->getVersion())
+            latest = index;
+        return index;
+    }
+};
+
+// REACH answers aren't cached, the index already makes them cheap
+inline void registerReachability(AlgorithmRegistry& registry) {
+    auto indexes = std::make_shared<ReachabilityIndexes>();
+
+    registry.add("REACH", 2, false, [indexes] (Graph& graph, Node* const* nodes) {
+        output << (indexes->forGraph(graph)->reaches(nodes[0], nodes[1]) ? "true" : "false") << '\n';
+    });
+    registry.add("REACH_INDEX", 0, false, [indexes] (Graph& graph, Node* const*) {
+        indexes->forGraph(graph)->printStats();
+    });
+}
@@ -1,23 +1,36 @@
-#include "graph.hpp"
-#include <functional>
+#pragma once
 
-// find strongly connected components
-void Tarjan(Graph& graph, Node* root) {
-    uns long curr_index = 0;
-    std::stack<Node*> DFS_Stack;
+#include "../common/registry.hpp"
+#include "../common/scratch.hpp"
 
+// kept between queries, see scratch.hpp
+struct TarjanScratch {
     // -1 means undefined
-    std::vector<long long> indexes(graph.getNodesCount(), -1);
-    std::vector<long long> lowlink_indexes(graph.getNodesCount(), -1);
-    std::vector<bool> isOnStack(graph.getNodesCount(), false);
+    StampedArray<long long> indexes;
+    StampedArray<long long> lowlink_indexes;
+    StampedArray<bool> isOnStack;
+    std::vector<Node*> DFS_Stack;
+    std::vector<Node*> outputSCC;
+};
+
+class TarjanSearch {
+private:
+    TarjanScratch& scratch;
+    uns long curr_index = 0;
+
+public:
+    explicit TarjanSearch(TarjanScratch& scratch) : scratch(scratch) {}
+
+    void strongConnect(Node* node) {
+        auto& indexes = scratch.indexes;
+        auto& lowlink_indexes = scratch.lowlink_indexes;
+        auto& isOnStack = scratch.isOnStack;
 
-    std::function<void(Node*)> strongConnect =
-            [&strongConnect, &graph, &DFS_Stack, &curr_index, &indexes, &lowlink_indexes, &isOnStack] (Node* node) -> void {
         indexes[node->getId()] = (signed long long)curr_index;
         lowlink_indexes[node->getId()] = (signed long long)curr_index;
         curr_index++;
 
-        DFS_Stack.push(node);
+        scratch.DFS_Stack.push_back(node);
         isOnStack[node->getId()] = true;
 
         // successors' processing
@@ -36,11 +49,12 @@ void Tarjan(Graph& graph, Node* root) {
         // if node is root, it must lead to SCC
         if (lowlink_indexes[node->getId()] == indexes[node->getId()]) {
             Node* curr_node = nullptr;
-            std::vector<Node*> outputSCC;
+            auto& outputSCC = scratch.outputSCC;
+            outputSCC.clear();
 
             do {
-                curr_node = DFS_Stack.top();
-                DFS_Stack.pop();
+                curr_node = scratch.DFS_Stack.back();
+                scratch.DFS_Stack.pop_back();
 
                 isOnStack[curr_node->getId()] = false;
                 outputSCC.push_back(curr_node);
@@ -48,14 +62,28 @@ void Tarjan(Graph& graph, Node* root) {
 
             if (outputSCC.size() > 1) {
                 for (auto i : outputSCC) 
-                    std::cout << i->getMark() << " ";
+                    output << i->getMark() << " ";
                 
-                std::cout << std::endl;
+                output << '\n';
             }
         }
-    };
+    }
+};
 
+// find strongly connected components
+void Tarjan(Graph& graph, Node* root) {
+    auto& scratch = queryScratch<TarjanScratch>();
+    scratch.indexes.reset(graph.getNodesCount(), -1);
+    scratch.lowlink_indexes.reset(graph.getNodesCount(), -1);
+    scratch.isOnStack.reset(graph.getNodesCount(), false);
+    scratch.DFS_Stack.clear();
 
     // since the starting point (root) is given, no need to check unconnected graphs
-    strongConnect(root);
+    TarjanSearch(scratch).strongConnect(root);
+}
+
+inline void registerTarjan(AlgorithmRegistry& registry) {
+    registry.add("TARJAN", 1, true, [] (Graph& graph, Node* const* nodes) {
+        Tarjan(graph, nodes[0]);
+    });
 }
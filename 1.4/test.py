@@ -6,7 +6,7 @@ import subprocess
 import networkx as nx
 import matplotlib.pyplot as plt
 
-def generate_test_case(num_nodes, num_edges, weight_range=(1, 100), remove_prob=0.2):
+def generate_test_case(num_nodes, num_edges, weight_range=(1, 100), remove_prob=0.2, reach_queries=0):
     nodes = []
     edges = []
     commands = []
@@ -41,7 +41,13 @@ def generate_test_case(num_nodes, num_edges, weight_range=(1, 100), remove_prob=
             edges.remove((a, b, w))
     
     
-    if nodes:
+    # reachability between random pairs (and of a node from itself) instead of TARJAN,
+    # their answers come in a fixed order
+    if nodes and reach_queries:
+        for i in range(reach_queries):
+            a, b = random.choice(nodes), random.choice(nodes)
+            commands.append(f"REACH {a} {b}")
+    elif nodes:
         root = random.choice(nodes)
         commands.append(f"TARJAN {root}")
     
@@ -227,6 +233,25 @@ class Validator:
 
                 output += "\n".join(" ".join(comp) for comp in non_trivial_SCC)
                 continue
+
+            if splits[0] == "REACH":
+                splits.pop(0)
+                a, b = splits[0], splits[1]
+                splits.pop(0)
+                splits.pop(0)
+
+                if a not in self.node_labels and b not in self.node_labels:
+                    output += f"Unknown nodes {a} {b}\n"
+                    continue
+                if a not in self.node_labels:
+                    output += f"Unknown node {a}\n"
+                    continue
+                if b not in self.node_labels:
+                    output += f"Unknown node {b}\n"
+                    continue
+
+                output += ("true" if nx.has_path(self.graph, a, b) else "false") + "\n"
+                continue
                     
             # may be unused
             if splits[0] == "VISUALIZE":
@@ -287,6 +312,26 @@ def generate_files():
     write_file("tests/test_big.txt", big_test)
     generated_files += ["tests/test_big.txt"]
 
+    for i in range(1, 4):
+        reach_test = generate_test_case(
+            num_nodes=random.randint(5, 15),
+            num_edges=random.randint(5, 25),
+            remove_prob=0.1,
+            reach_queries=20
+        )
+        write_file(f"tests/test_reach_{i}.txt", reach_test)
+        generated_files += [f"tests/test_reach_{i}.txt"]
+
+    # sparse enough for long chains of SCCs, so interval labels can't decide every query
+    reach_big_test = generate_test_case(
+        num_nodes=60,
+        num_edges=90,
+        remove_prob=0.02,
+        reach_queries=200
+    )
+    write_file("tests/test_reach_big.txt", reach_big_test)
+    generated_files += ["tests/test_reach_big.txt"]
+
     return generated_files
 
 
@@ -297,14 +342,16 @@ files_list = generate_files()
 
 
 
-for file_path in files_list:
+# bin/main_intervals answers REACH from interval labels (see Makefile), bin/main from the bitset closure
+for binary in ["bin/main", "bin/main_intervals"]:
+  for file_path in files_list:
     validator = Validator()
     with open(file_path, 'r') as f:
         print('-'*20)
-        print("Testing " + file_path)
+        print("Testing " + file_path + " with " + binary)
         print("Script:\n")
         file_start = f.tell()
-        process_out = subprocess.check_output(["bin/main"], stdin=f).decode("utf-8")
+        process_out = subprocess.check_output([binary], stdin=f).decode("utf-8")
         print(process_out)
 
 
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "output.hpp"
+#include "marks.hpp"
+#include "wal.hpp"
+
+// mutations are collected in a delta instead of being applied one by one: every removal
+// used to erase from graph's vectors and renumber ids. the delta is applied by
+// Graph::applyDelta in one pass once the run of mutations ends (see apply), the graph
+// comes out the same as if each of them was applied on its own.
+//
+// while the delta is pending, marks are resolved against it first, so messages
+// ("Unknown node", "tried creating already existing node", ...) are the same too.
+// nodes are referred to by ids the graph had when the batch started,
+// new ones get ids from that count on. accepted mutations go to the log when applied
+
+template <class Graph>
+class MutationBatch {
+private:
+    typedef typename Graph::DeltaEdge DeltaEdge;
+
+    struct Record {
+        LogRecord type;
+        long src;
+        long drain;
+        decltype(DeltaEdge::weight) weight;
+    };
+
+    bool active = false;        // graph is frozen until the delta is applied
+    bool transaction = false;   // BEGIN was given, delta waits for COMMIT
+    uint64_t base_nodes = 0;
+
+    std::vector<bool> removed_nodes;
+    std::vector<bool> removed_edges;
+    std::vector<Mark> new_nodes;
+    std::vector<bool> dead_nodes;
+    std::vector<DeltaEdge> new_edges;
+    std::vector<bool> dead_edges;
+    std::unordered_map<long, std::vector<size_t>> new_out_edges;
+    std::vector<Record> records;
+
+    // handles of marks created or removed by the batch, -1 for removed
+    std::unordered_map<uint64_t, long> changed;
+
+    void start(Graph& graph) {
+        if (active)
+            return;
+
+        active = true;
+        base_nodes = graph.getNodesCount();
+    }
+
+    Mark markOf(Graph& graph, long node) {
+        if ((uint64_t)node < base_nodes)
+            return graph.getNode((uint64_t)node)->getMark();
+        return new_nodes[node - base_nodes];
+    }
+
+    bool isAlive(long node) {
+        if ((uint64_t)node < base_nodes)
+            return removed_nodes.empty() || !removed_nodes[node];
+        return !dead_nodes[node - base_nodes];
+    }
+
+public:
+    MutationBatch() = default;
+
+    MutationBatch(const MutationBatch&) = delete;
+    MutationBatch& operator=(const MutationBatch&) = delete;
+
+    // id of the node with the mark as the batch sees it, -1 if there's none
+    long find(Graph& graph, std::string_view mark) {
+        start(graph);
+
+        Mark handle;
+        if (!mark_table.find(mark, handle))
+            return -1;
+
+        auto curr = changed.find(handle.getHandle());
+        if (curr != changed.end())
+            return curr->second;
+
+        auto node = graph.getNode(handle);
+        return node ? (long)node->getId() : -1;
+    }
+
+    // returns false if node already exists
+    bool addNode(Graph& graph, std::string_view mark) {
+        if (find(graph, mark) >= 0) {
+            output << "tried creating already existing node " << mark << '\n';
+            return false;
+        }
+
+        long node = base_nodes + new_nodes.size();
+        new_nodes.push_back(mark_table.intern(mark));
+        dead_nodes.push_back(false);
+        changed[new_nodes.back().getHandle()] = node;
+        records.push_back({LogRecord::Node, node, -1, 0});
+        return true;
+    }
+
+    // nodes must be alive, i.e. found by find
+    void addEdge(long src, long drain, decltype(DeltaEdge::weight) weight) {
+        new_out_edges[src].push_back(new_edges.size());
+        new_edges.push_back({(uint64_t)src, (uint64_t)drain, weight});
+        dead_edges.push_back(false);
+        records.push_back({LogRecord::Edge, src, drain, weight});
+    }
+
+    // edges of the node are dropped along with it
+    void removeNode(Graph& graph, long node) {
+        records.push_back({LogRecord::RemoveNode, node, -1, 0});
+
+        if ((uint64_t)node < base_nodes) {
+            if (removed_nodes.empty())
+                removed_nodes.resize(base_nodes, false);
+            removed_nodes[node] = true;
+        } else
+            dead_nodes[node - base_nodes] = true;
+
+        changed[markOf(graph, node).getHandle()] = -1;
+    }
+
+    // as Graph::disconnect, the edge with the lowest id goes: graph's edges come first,
+    // then the batch's ones in order. returns false if there's no such edge
+    bool removeEdge(Graph& graph, long src, long drain) {
+        bool found = false;
+
+        if ((uint64_t)src < base_nodes && (uint64_t)drain < base_nodes) {
+            auto target = graph.getNode((uint64_t)drain);
+            for (auto i : graph.getNode((uint64_t)src)->getOutEdges())
+                if (i->getDrain() == target && (removed_edges.empty() || !removed_edges[i->getId()])) {
+                    if (removed_edges.empty())
+                        removed_edges.resize(graph.getEdgesCount(), false);
+                    removed_edges[i->getId()] = true;
+                    found = true;
+                    break;
+                }
+        }
+
+        auto out = new_out_edges.find(src);
+        if (!found && out != new_out_edges.end())
+            for (auto i : out->second)
+                if (!dead_edges[i] && new_edges[i].drain == (uint64_t)drain) {
+                    dead_edges[i] = true;
+                    found = true;
+                    break;
+                }
+
+        if (!found) {
+            output << "Unknown edge " << markOf(graph, src) << " " << markOf(graph, drain) << '\n';
+            return false;
+        }
+
+        records.push_back({LogRecord::RemoveEdge, src, drain, 0});
+        return true;
+    }
+
+    // a run of NODE/EDGE commands deferred by a transaction, messages are the same as Graph::bulkBuild's
+    template <class Commands>
+    void bulkBuild(Graph& graph, const Commands& commands) {
+        for (auto& i : commands) {
+            if (!i.is_edge) {
+                addNode(graph, i.src);
+                continue;
+            }
+
+            auto src = find(graph, i.src);
+            auto drain = find(graph, i.drain);
+
+            if (src < 0 && drain < 0)
+                output << "Unknown nodes " << i.src << " " << i.drain << '\n';
+            else if (src < 0)
+                output << "Unknown node " << i.src << '\n';
+            else if (drain < 0)
+                output << "Unknown node " << i.drain << '\n';
+            else
+                addEdge(src, drain, i.weight);
+        }
+    }
+
+    void begin() {
+        transaction = true;
+    }
+
+    bool inTransaction() const {
+        return transaction;
+    }
+
+    // ends the transaction, its delta is applied by apply as usual
+    void commit() {
+        transaction = false;
+    }
+
+    // logs accepted mutations and applies the delta, returns true if the graph was changed.
+    // new nodes and edges which were removed by the batch itself never reach the graph
+    bool apply(Graph& graph) {
+        if (!active)
+            return false;
+
+        for (auto& i : records) {
+            MarkText src(markOf(graph, i.src));
+            if (i.type == LogRecord::Node)
+                mutation_log.node(src.view());
+            else if (i.type == LogRecord::Edge)
+                mutation_log.edge(src.view(), MarkText(markOf(graph, i.drain)).view(), i.weight);
+            else if (i.type == LogRecord::RemoveNode)
+                mutation_log.removeNode(src.view());
+            else
+                mutation_log.removeEdge(src.view(), MarkText(markOf(graph, i.drain)).view());
+        }
+
+        // new nodes which survived are numbered after graph's ones
+        std::vector<uint64_t> final_ids(new_nodes.size());
+        std::vector<Mark> nodes;
+        for (size_t i = 0; i < new_nodes.size(); i++)
+            if (!dead_nodes[i]) {
+                final_ids[i] = base_nodes + nodes.size();
+                nodes.push_back(new_nodes[i]);
+            }
+
+        std::vector<DeltaEdge> edges;
+        for (size_t i = 0; i < new_edges.size(); i++) {
+            auto edge = new_edges[i];
+            if (dead_edges[i] || !isAlive(edge.src) || !isAlive(edge.drain))
+                continue;
+
+            if (edge.src >= base_nodes)
+                edge.src = final_ids[edge.src - base_nodes];
+            if (edge.drain >= base_nodes)
+                edge.drain = final_ids[edge.drain - base_nodes];
+            edges.push_back(edge);
+        }
+
+        bool changes = !removed_nodes.empty() || !removed_edges.empty() || !nodes.empty() || !edges.empty();
+        if (changes)
+            graph.applyDelta(removed_nodes, removed_edges, nodes, edges);
+
+        active = false;
+        std::vector<bool>().swap(removed_nodes);
+        std::vector<bool>().swap(removed_edges);
+        changed.clear();
+        new_nodes.clear();
+        dead_nodes.clear();
+        new_edges.clear();
+        dead_edges.clear();
+        new_out_edges.clear();
+        records.clear();
+
+        return changes;
+    }
+};
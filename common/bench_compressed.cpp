@@ -0,0 +1,87 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <malloc.h>
+#include "compressed.hpp"
+#include "bench_traversals.hpp"
+
+// compressed graph against Graph's objects: bytes per edge, and edges scanned per second by
+// BFS (the engine's), reverse postorder and Tarjan's SCC (the same iterative code over both).
+// graphs are random and local (neighbours close by id, which varints encode best)
+
+#define BENCH_NODES 200000
+#define BENCH_EDGES 1600000
+#define BENCH_LOCAL_SPAN 64         // local graph's drains are at most this far from sources
+
+struct CompressedAdjacency {
+    const CompressedGraph& graph;
+
+    CompressedGraph::Cursor cursor(uns long node) {
+        return graph.successors(node);
+    }
+};
+
+void compare(const char* name, const std::vector<Graph::DeltaEdge>& edges) {
+    std::vector<std::string> marks;
+    std::vector<Graph::BuildCommand> commands;
+    for (size_t i = 0; i < BENCH_NODES; i++)
+        marks.push_back(std::to_string(i));
+    for (auto& i : marks)
+        commands.push_back({false, i, {}, 0});
+    for (auto& i : edges)
+        commands.push_back({true, marks[i.src], marks[i.drain], i.weight});
+
+    auto heap = mallinfo2().uordblks;
+    Graph graph;
+    graph.bulkBuild(commands);
+    size_t graph_bytes = mallinfo2().uordblks - heap;
+
+    CompressedGraph compressed;
+    CompressedGraph::build(compressed, BENCH_NODES, [&edges] (auto&& emit) {
+        for (auto& i : edges)
+            emit(i.src, i.drain, i.weight);
+    });
+
+    std::cout << name << " graph, " << BENCH_NODES << " nodes, " << edges.size() << " edges" << std::endl;
+    std::cout << "  Graph: " << (double)graph_bytes / edges.size() << " bytes per edge (nodes and marks included)" << std::endl;
+    std::cout << "  compressed: " << (double)compressed.size() / edges.size() << " bytes per edge (both directions and weights)" << std::endl;
+
+    GraphArcs graph_arcs{graph};
+    CompressedArcs compressed_arcs{compressed};
+    GraphAdjacency graph_adjacency{graph};
+    CompressedAdjacency compressed_adjacency{compressed};
+
+    std::pair<const char*, std::function<unsigned long()>> cases[][2] = {
+        {{"BFS", [&] () { return breadthFirst(graph_arcs, BENCH_NODES); }},
+         {"BFS", [&] () { return breadthFirst(compressed_arcs, BENCH_NODES); }}},
+        {{"RPO", [&] () { return reversePostorder(graph_adjacency, BENCH_NODES); }},
+         {"RPO", [&] () { return reversePostorder(compressed_adjacency, BENCH_NODES); }}},
+        {{"SCC", [&] () { return stronglyConnected(graph_adjacency, BENCH_NODES); }},
+         {"SCC", [&] () { return stronglyConnected(compressed_adjacency, BENCH_NODES); }}},
+    };
+
+    for (auto& [plain, packed] : cases) {
+        unsigned long plain_checksum, packed_checksum;
+        auto plain_time = measure(plain.second, plain_checksum);
+        auto packed_time = measure(packed.second, packed_checksum);
+
+        std::cout << "  " << plain.first << ": Graph " << edges.size() / plain_time / 1e6 << " M edges/s, compressed " <<
+        edges.size() / packed_time / 1e6 << " M edges/s (checksums " << plain_checksum << ", " << packed_checksum << ")" << std::endl;
+    }
+}
+
+int main() {
+    std::mt19937 rng(42);
+    thread_pool.setThreads(1);
+
+    std::vector<Graph::DeltaEdge> random_edges, local_edges;
+    for (size_t i = 0; i < BENCH_EDGES; i++) {
+        random_edges.push_back({rng() % BENCH_NODES, rng() % BENCH_NODES, (EDGE_WEIGHT_T)(rng() % 100)});
+
+        uns long src = rng() % BENCH_NODES;
+        local_edges.push_back({src, (src + rng() % BENCH_LOCAL_SPAN) % BENCH_NODES, (EDGE_WEIGHT_T)(rng() % 100)});
+    }
+
+    compare("random", random_edges);
+    compare("local", local_edges);
+}
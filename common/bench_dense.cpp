@@ -0,0 +1,83 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <functional>
+#include "../1.1/components.hpp"
+#include "../1.2/dijkstra.hpp"
+#include "../1.3/bfs.hpp"
+#include "../1.4/tarjan.hpp"
+
+// queries on dense graphs with the bit matrices (dense.hpp) and without them (--dense 0):
+// a random graph and a DAG of forward edges with 2-cycles, which has many small SCCs.
+// matrices are built by a warm-up query, so only queries are timed. TARJAN never switches
+// to the matrices, it's timed to show both runs do the same for it
+
+#define BENCH_NODES 3000
+#define BENCH_QUERIES 20
+
+void report(const char* name, Graph& graph) {
+    std::mt19937 rng(7);
+    std::vector<Node*> roots;
+    for (size_t i = 0; i < BENCH_QUERIES; i++)
+        roots.push_back(graph.getNode(rng() % graph.getNodesCount()));
+
+    std::pair<const char*, std::function<void(Node*)>> cases[] = {
+        {"BFS", [&graph] (Node* root) { BFS_Distances(graph, root); }},
+        {"DIJKSTRA", [&graph] (Node* root) { Dijkstra_path(graph, root); }},
+        {"COMPONENTS", [&graph] (Node*) { Components(graph); }},
+        {"TARJAN", [&graph] (Node* root) { Tarjan(graph, root); }},
+    };
+
+    std::cout << name << ": " << graph.getNodesCount() << " nodes, " << graph.getEdgesCount() << " edges" << std::endl;
+    output.setMuted(true);
+    for (auto& [query, run] : cases) {
+        double elapsed[2];
+        for (int enabled = 1; enabled >= 0; enabled--) {
+            dense_graphs.setEnabled(enabled);
+            run(roots[0]);  // warm up, builds the matrices
+
+            auto start = std::chrono::steady_clock::now();
+            for (auto root : roots)
+                run(root);
+            std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+            elapsed[enabled] = time.count();
+        }
+
+        output.flush();
+        std::cout << "  " << query << " x" << BENCH_QUERIES << ": matrices " << elapsed[1] * 1000 << " ms, edges " <<
+        elapsed[0] * 1000 << " ms, speedup " << elapsed[0] / elapsed[1] << std::endl;
+    }
+    output.setMuted(false);
+}
+
+void build(Graph& graph, std::mt19937& rng, std::function<bool(size_t, size_t)> has_edge) {
+    std::vector<std::string> marks;
+    std::vector<Graph::BuildCommand> commands;
+    for (size_t i = 0; i < BENCH_NODES; i++)
+        marks.push_back(std::to_string(i));
+    for (auto& i : marks)
+        commands.push_back({false, i, {}, 0});
+
+    for (size_t i = 0; i < BENCH_NODES; i++)
+        for (size_t j = 0; j < BENCH_NODES; j++)
+            if (i != j && has_edge(i, j))
+                commands.push_back({true, marks[i], marks[j], (EDGE_WEIGHT_T)(rng() % 100 + 1)});
+
+    graph.bulkBuild(commands);
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    // matrices are kept for the latest version, so the graph built second takes more changes
+    // (a higher version) than the first, or its queries would build them over and over
+    Graph layered;
+    build(layered, rng, [&] (size_t i, size_t j) { return (i < j && coin(rng) < 0.3) || (i ^ 1) == j; });
+    report("DAG, p = 0.3, with 2-cycles", layered);
+
+    Graph random_graph;
+    build(random_graph, rng, [&] (size_t, size_t) { return coin(rng) < 0.2; });
+    report("random, p = 0.2", random_graph);
+}
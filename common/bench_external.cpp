@@ -0,0 +1,121 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <string>
+#include <chrono>
+#include <functional>
+#include "external.hpp"
+
+// external-memory mode: a random graph is written by buildSnapshot in passes bounded by a budget,
+// then traversed from the file. every traversal starts cold (the file's pages are dropped)
+// and reports what it read from the disk next to the size of the file.
+// bench_external [nodes] [edges] [budget MB] [snapshot path]
+
+#define BENCH_NODES 2000000ul
+#define BENCH_EDGES 20000000ul
+#define BENCH_BUDGET_MB 32ul
+#define BENCH_PATH "bench_external.snap"
+
+// counter of /proc/self/io, bytes which really came from the disk
+size_t readBytes() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    size_t value = 0;
+    while (io >> key >> value)
+        if (key == "read_bytes:")
+            return value;
+    return 0;
+}
+
+// field of /proc/self/status, in KB
+size_t memoryKB(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind(field, 0) == 0)
+            return std::stoul(line.substr(field.size()));
+    return 0;
+}
+
+void dropCache(const char* path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    size_t nodes = argc > 1 ? std::stoul(argv[1]) : BENCH_NODES;
+    size_t edges = argc > 2 ? std::stoul(argv[2]) : BENCH_EDGES;
+    size_t budget = (argc > 3 ? std::stoul(argv[3]) : BENCH_BUDGET_MB) << 20;
+    const char* path = argc > 4 ? argv[4] : BENCH_PATH;
+    output.setMuted(true);
+
+    // the same stream every pass, as a file read again would be
+    size_t passes = 0;
+    auto stream = [&] (auto&& emit) {
+        std::mt19937_64 rng(42);
+        passes++;
+        for (size_t i = 0; i < edges; i++) {
+            auto random = rng();
+            emit((random >> 32) % nodes, (random & 0xffffffff) % nodes, (ExternalWeight)(random >> 58));
+        }
+    };
+    std::string mark;
+    auto marks = [&mark] (uint64_t node) -> std::string_view {
+        mark = std::to_string(node);
+        return mark;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (buildSnapshot(path, nodes, marks, stream, budget) != SnapshotResult::Done) {
+        std::cout << "Cannot write " << path << std::endl;
+        return 1;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    struct stat info;
+    stat(path, &info);
+    std::cout << nodes << " nodes, " << edges << " edges, snapshot " << (info.st_size >> 20) << " MB built in " <<
+    passes << " passes of the stream (budget " << (budget >> 20) << " MB), " << elapsed.count() << " s" << std::endl;
+
+    ExternalGraph graph;
+    if (graph.open(path) != SnapshotResult::Done) {
+        std::cout << "Cannot open " << path << std::endl;
+        return 1;
+    }
+    auto& scratch = queryScratch<ExternalScratch>();
+
+    std::pair<const char*, std::function<void()>> cases[] = {
+        {"BFS", [&] () { externalBFS(graph, 0, scratch); }},
+        {"RPO", [&] () { externalDFS(graph, 0, scratch); }},
+        {"TARJAN", [&] () { externalTarjan(graph, 0, scratch); }},
+    };
+
+    for (auto& [name, run] : cases)
+        for (auto cold : {true, false}) {
+            if (cold) {
+                graph.evict();
+                dropCache(path);
+            }
+
+            auto read_before = readBytes();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            std::cout << "  " << name << (cold ? " cold: " : " warm: ") << elapsed.count() * 1000 << " ms, read " <<
+            ((readBytes() - read_before) >> 20) << " MB" << std::endl;
+        }
+
+    // resident pages of the file are the page cache's, which gives them up under pressure
+    output.flush();
+    output.setMuted(false);
+    graph.printStats();
+    output.flush();
+    std::cout << "resident: own " << (memoryKB("RssAnon:") >> 10) << " MB, file " << (memoryKB("RssFile:") >> 10) <<
+    " MB" << std::endl;
+    unlink(path);
+}
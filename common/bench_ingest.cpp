@@ -0,0 +1,125 @@
+#include <iostream>
+#include <queue>
+#include <chrono>
+#include <random>
+#include "tokenizer.hpp"
+
+// compares tokenization of the command loop: copying tokens into a queue of strings
+// (as main.cpp used to) versus string_view tokens with from_chars parsing.
+// graph itself isn't touched, only the ingest path up to dispatch
+
+#define BENCH_LINES 2000000
+
+void splitLine(const std::string& input_line, std::queue<std::string>& request) {
+    size_t start = 0;
+    size_t end = input_line.find(' ');
+
+    while (end != std::string::npos) {
+        request.push(input_line.substr(start, end - start));
+        start = end + 1;
+        end = input_line.find(' ', start);
+    }
+
+    request.push(input_line.substr(start));
+}
+
+// returns checksum so the work can't be optimized away
+unsigned long copyingIngest(const std::vector<std::string>& lines) {
+    unsigned long checksum = 0;
+
+    for (auto& input_line : lines) {
+        std::queue<std::string> request;
+        splitLine(input_line, request);
+
+        while (!request.empty()) {
+            if (request.front() == "NODE") {
+                request.pop();
+                auto name = request.front();
+                checksum += name.size();
+                request.pop();
+                continue;
+            }
+
+            if (request.front() == "EDGE") {
+                request.pop();
+                auto src_name = request.front();
+                request.pop();
+                auto drain_name = request.front();
+                request.pop();
+                auto weight = std::stoi(request.front());
+                request.pop();
+
+                checksum += src_name.size() + drain_name.size() + weight;
+                continue;
+            }
+
+            request.pop();
+        }
+    }
+
+    return checksum;
+}
+
+unsigned long viewIngest(const std::vector<std::string>& lines) {
+    unsigned long checksum = 0;
+
+    for (auto& input_line : lines) {
+        Tokenizer request(input_line);
+
+        while (!request.empty()) {
+            if (request.front() == "NODE") {
+                request.pop();
+                auto name = request.front();
+                checksum += name.size();
+                request.pop();
+                continue;
+            }
+
+            if (request.front() == "EDGE") {
+                request.pop();
+                auto src_name = request.front();
+                request.pop();
+                auto drain_name = request.front();
+                request.pop();
+                unsigned weight = 0;
+                parseNumber(request.front(), weight);
+                request.pop();
+
+                checksum += src_name.size() + drain_name.size() + weight;
+                continue;
+            }
+
+            request.pop();
+        }
+    }
+
+    return checksum;
+}
+
+template <class F>
+void measure(const char* name, const std::vector<std::string>& lines, F&& ingest) {
+    auto start = std::chrono::steady_clock::now();
+    auto checksum = ingest(lines);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << name << ": " << (unsigned long)(lines.size() / elapsed.count()) << " lines/s" <<
+    " (checksum " << checksum << ")" << std::endl;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<std::string> lines;
+    lines.reserve(BENCH_LINES);
+
+    // same shape as test.py generates: numbered labels, mostly edges
+    for (unsigned long i = 0; i < BENCH_LINES; i++) {
+        if (i % 10 == 0)
+            lines.push_back("NODE " + std::to_string(i / 10));
+        else
+            lines.push_back("EDGE " + std::to_string(rng() % 100000) + " " + std::to_string(rng() % 100000) +
+                            " " + std::to_string(rng() % 100 + 1));
+    }
+
+    measure("queue<string> + stoi", lines, copyingIngest);
+    measure("string_view + from_chars", lines, viewIngest);
+}
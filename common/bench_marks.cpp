@@ -0,0 +1,137 @@
+#include <iostream>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <tuple>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "graph.hpp"
+
+// ingest of a graph through Graph::bulkBuild with decimal marks (kept as numbers, see marks.hpp)
+// and with string marks (interned), against nodes holding their own std::string indexed by a hash
+// map of views, which is what bulkBuild did before. reports resident memory the build added and
+// time of random lookups by mark. each run is a child process, so memory freed by another run
+// isn't reused.
+// bench_marks [nodes]
+
+#define BENCH_DEGREE 4
+#define BENCH_LOOKUPS 2000000
+
+// resident set size in bytes
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size, resident;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+struct OwnMarkNode {
+    std::string mark;
+    unsigned long id;
+};
+
+struct InternedNode {
+    Mark mark;
+    unsigned long id;
+};
+
+template <class Build, class Lookup>
+void run(const char* name, size_t nodes, const std::vector<std::string>& marks, Build&& build, Lookup&& lookup) {
+    auto child = fork();
+    if (child) {
+        waitpid(child, nullptr, 0);
+        return;
+    }
+
+    auto before = residentBytes();
+    auto start = std::chrono::steady_clock::now();
+    build();
+    std::chrono::duration<double> building = std::chrono::steady_clock::now() - start;
+    auto added = residentBytes() - before;
+
+    std::mt19937 rng(7);
+    unsigned long checksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_LOOKUPS; i++)
+        checksum += lookup(marks[rng() % nodes]);
+    std::chrono::duration<double> looking = std::chrono::steady_clock::now() - start;
+
+    std::cout << name << ": built in " << building.count() * 1000 << " ms, " << added / nodes << " bytes/node, " <<
+    looking.count() * 1e9 / BENCH_LOOKUPS << " ns/lookup (checksum " << checksum << ")" << std::endl;
+    _exit(0);
+}
+
+int main(int argc, char** argv) {
+    size_t nodes = argc > 1 ? std::stoul(argv[1]) : 200000;
+    std::cout << nodes << " nodes, " << nodes * BENCH_DEGREE << " edges" << std::endl;
+
+    // longer than the small string buffer. marks of the index-only runs are new to the table
+    std::vector<std::string> numeric(nodes), named(nodes), keys(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        numeric[i] = std::to_string(i);
+        named[i] = "vertex-" + std::to_string(i) + "-of-the-graph";
+        keys[i] = "key-" + std::to_string(i) + "-of-the-index";
+    }
+
+    auto commands = [&] (const std::vector<std::string>& marks) {
+        std::mt19937 rng(42);
+        std::vector<Graph::BuildCommand> result;
+        result.reserve(nodes * (BENCH_DEGREE + 1));
+        for (auto& i : marks)
+            result.push_back({false, i, {}, 0});
+        for (size_t i = 0; i < nodes * BENCH_DEGREE; i++)
+            result.push_back({true, marks[rng() % nodes], marks[rng() % nodes], 1});
+        return result;
+    };
+
+    auto numeric_commands = commands(numeric);
+    auto named_commands = commands(named);
+    for (auto [name, build_commands, marks] : {std::make_tuple("numeric marks", &numeric_commands, &numeric),
+                                               std::make_tuple("string marks", &named_commands, &named)}) {
+        Graph graph;
+        run(name, nodes, *marks, [&] () {
+            graph.bulkBuild(*build_commands);
+        }, [&] (const std::string& mark) {
+            return graph.getNode(mark)->getId();
+        });
+    }
+
+    // the mark index alone: edges would cost both layouts the same
+    std::vector<std::unique_ptr<OwnMarkNode>> own;
+    std::unordered_map<std::string_view, OwnMarkNode*> own_index;
+    run("own strings (index only)", nodes, named, [&] () {
+        own_index.reserve(nodes);
+        for (size_t i = 0; i < nodes; i++) {
+            own.emplace_back(new OwnMarkNode{named[i], i});
+            own_index.emplace(own.back()->mark, own.back().get());
+        }
+    }, [&] (const std::string& mark) {
+        return own_index.find(mark)->second->id;
+    });
+
+    std::vector<std::unique_ptr<InternedNode>> interned;
+    MarkIndex<InternedNode> interned_index;
+    run("interned strings (index only)", nodes, keys, [&] () {
+        for (size_t i = 0; i < nodes; i++) {
+            interned.emplace_back(new InternedNode{mark_table.intern(keys[i]), i});
+            interned_index.set(interned.back()->mark, interned.back().get());
+        }
+    }, [&] (const std::string& mark) {
+        Mark handle;
+        mark_table.find(mark, handle);
+        return interned_index.get(handle)->id;
+    });
+
+    run("numeric marks (index only)", nodes, numeric, [&] () {
+        for (size_t i = 0; i < nodes; i++) {
+            interned.emplace_back(new InternedNode{mark_table.intern(numeric[i]), i});
+            interned_index.set(interned.back()->mark, interned.back().get());
+        }
+    }, [&] (const std::string& mark) {
+        Mark handle;
+        mark_table.find(mark, handle);
+        return interned_index.get(handle)->id;
+    });
+}
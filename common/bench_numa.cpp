@@ -0,0 +1,109 @@
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <functional>
+#include "numa.hpp"
+#include "pool.hpp"
+#include "bench_traversals.hpp"
+
+// a graph's CSR arrays placed three ways (see numa.hpp): written by the main thread, first-touched
+// by the pinned workers which later scan them, and interleaved over nodes. each placement runs
+// an edge sweep (every range streams its nodes' edges) and a pull step of PageRank (ranges read
+// ranks of random neighbours). the pool is NUMA-aware in every case, so ranges go to the same
+// workers; on a single node the placements can't differ and the times should match.
+// bench_numa [threads]
+
+#define BENCH_NODES 2000000ul
+#define BENCH_DEGREE 16
+#define BENCH_GRAIN 4096
+
+struct PlacedCSR {
+    NumaArray<uint64_t> offsets;
+    NumaArray<uint32_t> sources;         // in-edges, pull steps read them
+    NumaArray<double> ranks;
+    NumaArray<double> next;
+
+    // copied in the ranges they're going to be read in, by whoever placement says
+    PlacedCSR(const std::vector<uint64_t>& _offsets, const std::vector<uint32_t>& _sources, NumaPlacement placement) {
+        auto nodes = _offsets.size() - 1;
+        offsets.allocate(_offsets.size(), placement);
+        sources.allocate(_sources.size(), placement);
+        ranks.allocate(nodes, placement);
+        next.allocate(nodes, placement);
+
+        auto copy = [&] (size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                offsets[i + 1] = _offsets[i + 1];
+                ranks[i] = 1.0 / nodes;
+                next[i] = 0;
+            }
+            for (auto e = _offsets[begin]; e < _offsets[end]; e++)
+                sources[e] = _sources[e];
+        };
+
+        if (placement == NumaPlacement::Local)
+            thread_pool.parallelFor(0, nodes, BENCH_GRAIN, copy);
+        else
+            copy(0, nodes);
+    }
+};
+
+int main(int argc, char** argv) {
+    thread_pool.setThreads(argc > 1 ? std::stoul(argv[1]) : std::max(2u, std::thread::hardware_concurrency()));
+    thread_pool.setNumaAware(true);
+    std::cout << numa_topology.nodesCount() << " NUMA node(s), " << thread_pool.getThreads() << " threads" << std::endl;
+    if (numa_topology.nodesCount() == 1)
+        std::cout << "  single node: placements only differ in who touched the pages first" << std::endl;
+
+    // in-edges from random sources
+    std::mt19937 rng(42);
+    std::vector<uint64_t> offsets(BENCH_NODES + 1, 0);
+    std::vector<uint32_t> sources(BENCH_NODES * BENCH_DEGREE);
+    std::vector<uint32_t> out_degrees(BENCH_NODES, 0);
+    for (size_t i = 0; i < BENCH_NODES; i++) {
+        offsets[i + 1] = offsets[i] + BENCH_DEGREE;
+        for (size_t e = offsets[i]; e < offsets[i + 1]; e++)
+            out_degrees[sources[e] = rng() % BENCH_NODES]++;
+    }
+    std::cout << BENCH_NODES << " nodes, " << sources.size() << " edges" << std::endl;
+
+    std::pair<const char*, NumaPlacement> placements[] = {
+        {"main thread", NumaPlacement::Caller},
+        {"local", NumaPlacement::Local},
+        {"interleaved", NumaPlacement::Interleaved},
+    };
+
+    for (auto [name, placement] : placements) {
+        auto start = std::chrono::steady_clock::now();
+        PlacedCSR csr(offsets, sources, placement);
+        std::chrono::duration<double> placing = std::chrono::steady_clock::now() - start;
+
+        unsigned long sweep_checksum, pull_checksum;
+        auto sweep = measure([&] () {
+            std::atomic<unsigned long> sum{0};
+            thread_pool.parallelFor(0, BENCH_NODES, BENCH_GRAIN, [&] (size_t begin, size_t end) {
+                unsigned long local = 0;
+                for (auto e = csr.offsets[begin]; e < csr.offsets[end]; e++)
+                    local += csr.sources[e];
+                sum += local;
+            });
+            return sum.load();
+        }, sweep_checksum);
+
+        auto pull = measure([&] () {
+            thread_pool.parallelFor(0, BENCH_NODES, BENCH_GRAIN, [&] (size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    double rank = 0;
+                    for (auto e = csr.offsets[i]; e < csr.offsets[i + 1]; e++)
+                        rank += csr.ranks[csr.sources[e]] / out_degrees[csr.sources[e]];
+                    csr.next[i] = 0.15 / BENCH_NODES + 0.85 * rank;
+                }
+            });
+            return (unsigned long)(csr.next[0] * 1e15);
+        }, pull_checksum);
+
+        std::cout << name << " (placed in " << placing.count() * 1000 << " ms): edge sweep " << sweep * 1000 <<
+        " ms (" << sources.size() / sweep / 1e6 << " M edges/s, checksum " << sweep_checksum << "), pull step " <<
+        pull * 1000 << " ms (checksum " << pull_checksum << ")" << std::endl;
+    }
+}
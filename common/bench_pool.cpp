@@ -0,0 +1,110 @@
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include "../1.1/components.hpp"
+#include "../1.3/bfs.hpp"
+
+// scaling of the thread pool: the same work is timed with 1, 2, 4, ... threads
+// up to the hardware's count. parallelFor and fork-join are measured on their own,
+// then the algorithms which run on the pool, over one random graph.
+// the largest count can be given as an argument instead
+
+#define BENCH_NODES 200000
+#define BENCH_EDGES 1600000
+#define BENCH_SUM (1ul << 27)         // bytes summed
+#define BENCH_FORK_DEPTH 16
+
+// touches every element, so memory bandwidth is what's scaled
+unsigned long parallelSum(const std::vector<unsigned>& values) {
+    std::atomic<unsigned long> total(0);
+    thread_pool.parallelFor(0, values.size(), 1 << 16, [&values, &total] (size_t begin, size_t end) {
+        unsigned long sum = 0;
+        for (size_t i = begin; i < end; i++)
+            sum += values[i] * (unsigned long)values[i] % 7;
+        total += sum;
+    });
+    return total;
+}
+
+// binary tree of nested forks, leaves do a bit of arithmetic
+unsigned long forkTree(unsigned depth) {
+    if (depth == 0) {
+        unsigned long x = 0;
+        for (unsigned long i = 0; i < (1 << 12); i++)
+            x += i * i % 13;
+        return x;
+    }
+
+    unsigned long left = 0;
+    ThreadPool::TaskGroup group(thread_pool);
+    group.fork([&left, depth] () { left = forkTree(depth - 1); });
+    auto right = forkTree(depth - 1);
+    group.wait();
+    return left + right;
+}
+
+template <class F>
+double measure(F&& f, unsigned long& checksum) {
+    auto start = std::chrono::steady_clock::now();
+    checksum = f();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(42);
+
+    std::vector<unsigned> values(BENCH_SUM / sizeof(unsigned));
+    for (auto& i : values)
+        i = rng();
+
+    std::vector<std::string> marks;
+    std::vector<Graph::BuildCommand> commands;
+    for (size_t i = 0; i < BENCH_NODES; i++)
+        marks.push_back(std::to_string(i));
+    for (auto& i : marks)
+        commands.push_back({false, i, {}, 0});
+    for (size_t i = 0; i < BENCH_EDGES; i++)
+        commands.push_back({true, marks[rng() % BENCH_NODES], marks[rng() % BENCH_NODES], 1});
+
+    Graph graph;
+    graph.bulkBuild(commands);
+    GraphArcs arcs{graph};
+
+    std::pair<const char*, std::function<unsigned long()>> cases[] = {
+        {"parallelFor sum", [&values] () { return parallelSum(values); }},
+        {"fork-join tree", [] () { return forkTree(BENCH_FORK_DEPTH); }},
+        {"weak components", [&graph] () { return (unsigned long)weakComponents(graph).size(); }},
+        {"BFS", [&graph, &arcs] () {
+            BFS_Result result;
+            BFS_Engine::run(arcs, graph.getNodesCount(), 0, result);
+            unsigned long reached = 0;
+            for (uns i = 0; i < graph.getNodesCount(); i++)
+                reached += result.distances.get(i) != -1;
+            return reached;
+        }},
+    };
+
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1)
+        max_threads = std::max(1ul, std::stoul(argv[1]));
+    for (auto& [name, run] : cases) {
+        double single = 0;
+        for (size_t threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+            thread_pool.setThreads(threads);
+
+            unsigned long checksum;
+            run();  // warm up
+            auto elapsed = measure(run, checksum);
+            if (threads == 1)
+                single = elapsed;
+
+            std::cout << name << ", " << threads << " threads: " << elapsed * 1000 << " ms, speedup " <<
+            single / elapsed << " (checksum " << checksum << ")" << std::endl;
+
+            if (threads == max_threads)
+                break;
+        }
+    }
+}
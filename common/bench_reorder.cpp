@@ -0,0 +1,105 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <numeric>
+#include "reorder.hpp"
+#include "compressed.hpp"
+#include "bench_traversals.hpp"
+#include "../1.1/components.hpp"
+
+// traversals over a graph whose structure is local (a grid with a few long edges) but whose
+// nodes were inserted in random order, before and after REORDER with every strategy.
+// compressed size shows how close neighbours' ids got
+
+#define BENCH_SIDE 500              // grid's nodes are BENCH_SIDE^2
+#define BENCH_LONG_EDGES 1000       // edges between random nodes, per million
+
+struct CompressedAdjacency {
+    const CompressedGraph& graph;
+
+    CompressedGraph::Cursor cursor(uns long node) {
+        return graph.successors(node);
+    }
+};
+
+void report(const char* name, Graph& graph, double reorder_time) {
+    GraphArcs arcs{graph};
+    GraphAdjacency adjacency{graph};
+    auto nodes = graph.getNodesCount();
+    auto edges = graph.getEdgesCount();
+
+    std::cout << name;
+    if (reorder_time > 0)
+        std::cout << " (reordered in " << reorder_time * 1000 << " ms)";
+    CompressedGraph compressed;
+    CompressedGraph::fromGraph(compressed, graph);
+    std::cout << ": compressed " << (double)compressed.size() / edges << " bytes per edge" << std::endl;
+
+    std::pair<const char*, std::function<unsigned long()>> cases[] = {
+        {"BFS", [&] () { return breadthFirst(arcs, nodes); }},
+        {"RPO", [&] () { return reversePostorder(adjacency, nodes); }},
+        {"SCC", [&] () { return stronglyConnected(adjacency, nodes); }},
+        {"weak components", [&] () { return (unsigned long)weakComponents(graph).size(); }},
+    };
+
+    for (auto& [case_name, run] : cases) {
+        unsigned long checksum;
+        auto elapsed = measure(run, checksum);
+        std::cout << "  " << case_name << ": " << elapsed * 1000 << " ms, " << edges / elapsed / 1e6 <<
+        " M edges/s (checksum " << checksum << ")" << std::endl;
+    }
+}
+
+int main() {
+    std::mt19937 rng(42);
+    thread_pool.setThreads(1);
+
+    // cells link to their right and lower neighbours, half of them back as well
+    size_t count = BENCH_SIDE * BENCH_SIDE;
+    std::vector<Graph::DeltaEdge> edges;
+    for (size_t row = 0; row < BENCH_SIDE; row++)
+        for (size_t column = 0; column < BENCH_SIDE; column++) {
+            uns long cell = row * BENCH_SIDE + column;
+            for (uns long next : {cell + 1, cell + BENCH_SIDE}) {
+                if ((next == cell + 1 && column + 1 == BENCH_SIDE) || next >= count)
+                    continue;
+                edges.push_back({cell, next, 1});
+                if (rng() % 2)
+                    edges.push_back({next, cell, 1});
+            }
+            if (rng() % 1000000 < BENCH_LONG_EDGES)
+                edges.push_back({cell, rng() % count, 1});
+        }
+
+    // inserted in random order, so ids say nothing about the grid
+    std::vector<uns long> insertion(count);
+    std::iota(insertion.begin(), insertion.end(), 0);
+    std::shuffle(insertion.begin(), insertion.end(), rng);
+    std::shuffle(edges.begin(), edges.end(), rng);
+
+    std::vector<std::string> marks(count);
+    std::vector<Graph::BuildCommand> commands;
+    for (auto i : insertion) {
+        marks[i] = std::to_string(i);
+        commands.push_back({false, marks[i], {}, 0});
+    }
+    for (auto& i : edges)
+        commands.push_back({true, marks[i.src], marks[i.drain], i.weight});
+
+    Graph graph;
+    graph.bulkBuild(commands);
+    std::cout << count << " nodes, " << graph.getEdgesCount() << " edges" << std::endl;
+    report("insertion order", graph, 0);
+
+    for (auto strategy : {"RCM", "BFS", "DEGREE"}) {
+        auto reordered = graph.clone();
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uns long> order;
+        nodeOrder(*reordered, strategy, order);
+        reordered->reorder(order);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        report(strategy, *reordered, elapsed.count());
+    }
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <queue>
+#include <functional>
+#include "sharded.hpp"
+#include "bench_traversals.hpp"
+
+// sharded BFS and delta-stepping SSSP with 1, 2, 4, ... worker processes against in-process
+// references (BFS_Engine, binary-heap Dijkstra). first query of a worker count includes forking
+// the workers and building their partitions, it's reported apart.
+// bench_sharded [max workers]
+
+#define BENCH_NODES 200000ul
+#define BENCH_DEGREE 8
+#define BENCH_MAX_WEIGHT 100
+
+unsigned long checksum(const std::vector<uint64_t>& distances) {
+    unsigned long result = 0;
+    for (auto i : distances)
+        result = result * 31 + (i == std::numeric_limits<uint64_t>::max() ? 7 : i);
+    return result;
+}
+
+std::vector<uint64_t> heapDijkstra(Graph& graph, uns long root) {
+    std::vector<uint64_t> distances(graph.getNodesCount(), std::numeric_limits<uint64_t>::max());
+    std::priority_queue<std::pair<uint64_t, uns long>, std::vector<std::pair<uint64_t, uns long>>, std::greater<>> queue;
+    distances[root] = 0;
+    queue.push({0, root});
+
+    while (!queue.empty()) {
+        auto [distance, node] = queue.top();
+        queue.pop();
+        if (distance != distances[node])
+            continue;
+
+        for (auto i : graph.getNode(node)->getOutEdges()) {
+            auto drain = i->getDrain()->getId();
+            if (distance + i->getWeight() < distances[drain]) {
+                distances[drain] = distance + i->getWeight();
+                queue.push({distances[drain], drain});
+            }
+        }
+    }
+    return distances;
+}
+
+int main(int argc, char** argv) {
+    size_t max_workers = argc > 1 ? std::stoul(argv[1]) : 4;
+    std::mt19937 rng(42);
+    thread_pool.setThreads(1);
+
+    std::vector<std::string> marks(BENCH_NODES);
+    std::vector<Graph::BuildCommand> commands;
+    for (size_t i = 0; i < BENCH_NODES; i++) {
+        marks[i] = std::to_string(i);
+        commands.push_back({false, marks[i], {}, 0});
+    }
+    for (size_t i = 0; i < BENCH_NODES * BENCH_DEGREE; i++)
+        commands.push_back({true, marks[rng() % BENCH_NODES], marks[rng() % BENCH_NODES], (EDGE_WEIGHT_T)(rng() % BENCH_MAX_WEIGHT + 1)});
+
+    Graph graph;
+    graph.bulkBuild(commands);
+    std::cout << graph.getNodesCount() << " nodes, " << graph.getEdgesCount() << " edges" << std::endl;
+
+    unsigned long bfs_reference_checksum, sssp_reference_checksum;
+    std::vector<uint64_t> bfs_reference(graph.getNodesCount());
+    auto bfs_time = measure([&] () {
+        auto& result = queryScratch<BFS_Result>();
+        GraphArcs arcs{graph};
+        BFS_Engine::run(arcs, graph.getNodesCount(), 0, result);
+        for (uns long i = 0; i < graph.getNodesCount(); i++)
+            bfs_reference[i] = result.distances.get(i) == -1 ? std::numeric_limits<uint64_t>::max() : result.distances.get(i);
+        return checksum(bfs_reference);
+    }, bfs_reference_checksum);
+    std::vector<uint64_t> sssp_reference;
+    auto sssp_time = measure([&] () {
+        sssp_reference = heapDijkstra(graph, 0);
+        return checksum(sssp_reference);
+    }, sssp_reference_checksum);
+
+    std::cout << "in process: BFS " << bfs_time * 1000 << " ms (checksum " << bfs_reference_checksum <<
+    "), SSSP " << sssp_time * 1000 << " ms (checksum " << sssp_reference_checksum << ")" << std::endl;
+
+    std::vector<uint64_t> distances;
+    for (size_t workers = 1; workers <= max_workers; workers *= 2) {
+        sharded_engine.setWorkers(workers);
+
+        auto start = std::chrono::steady_clock::now();
+        sharded_engine.run(graph, ShardQuery::BFS, 0, distances);
+        std::chrono::duration<double> startup = std::chrono::steady_clock::now() - start;
+
+        unsigned long bfs_checksum, sssp_checksum;
+        auto bfs = measure([&] () {
+            sharded_engine.run(graph, ShardQuery::BFS, 0, distances);
+            return checksum(distances);
+        }, bfs_checksum);
+        auto sssp = measure([&] () {
+            sharded_engine.run(graph, ShardQuery::SSSP, 0, distances);
+            return checksum(distances);
+        }, sssp_checksum);
+
+        std::cout << workers << " workers (first query " << startup.count() * 1000 << " ms): BFS " << bfs * 1000 <<
+        " ms (checksum " << bfs_checksum << "), SSSP " << sssp * 1000 << " ms (checksum " << sssp_checksum << ")" << std::endl;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "../1.3/bfs.hpp"
+
+// traversals timed by the benchmarks, written once over any adjacency with cursor(node),
+// whose next(neighbour) gives successors one by one
+
+#define BENCH_ROUNDS 3              // best of
+
+// Graph's out-edges, iterated the way CompressedGraph::Cursor is
+struct GraphAdjacency {
+    Graph& graph;
+
+    struct Cursor {
+        EdgeSet::iterator iter, end;
+
+        bool next(uns long& neighbour) {
+            if (iter == end)
+                return false;
+            neighbour = (*iter++)->getDrain()->getId();
+            return true;
+        }
+    };
+
+    Cursor cursor(uns long node) {
+        auto& edges = graph.getNode(node)->getOutEdges();
+        return {edges.begin(), edges.end()};
+    }
+};
+
+// postorder of DFS from every unvisited node, returns the last node numbered
+template <class Adjacency>
+unsigned long reversePostorder(Adjacency& adjacency, size_t nodes_count) {
+    std::vector<uint8_t> visited(nodes_count, false);
+    std::vector<std::pair<uns long, decltype(adjacency.cursor(0))>> stack;
+    std::vector<uns long> order;
+    order.reserve(nodes_count);
+
+    for (uns long root = 0; root < nodes_count; root++) {
+        if (visited[root])
+            continue;
+
+        visited[root] = true;
+        stack.push_back({root, adjacency.cursor(root)});
+        while (!stack.empty()) {
+            uns long next;
+            if (stack.back().second.next(next)) {
+                if (!visited[next]) {
+                    visited[next] = true;
+                    stack.push_back({next, adjacency.cursor(next)});
+                }
+                continue;
+            }
+
+            order.push_back(stack.back().first);
+            stack.pop_back();
+        }
+    }
+
+    return order.back();
+}
+
+// Tarjan's algorithm without recursion, returns the number of components
+template <class Adjacency>
+unsigned long stronglyConnected(Adjacency& adjacency, size_t nodes_count) {
+    std::vector<long> indexes(nodes_count, -1), lowlinks(nodes_count);
+    std::vector<uint8_t> on_stack(nodes_count, false);
+    std::vector<uns long> component_stack;
+    std::vector<std::pair<uns long, decltype(adjacency.cursor(0))>> calls;
+    long index = 0;
+    unsigned long components = 0;
+
+    auto visit = [&] (uns long node) {
+        indexes[node] = lowlinks[node] = index++;
+        component_stack.push_back(node);
+        on_stack[node] = true;
+        calls.push_back({node, adjacency.cursor(node)});
+    };
+
+    for (uns long root = 0; root < nodes_count; root++) {
+        if (indexes[root] != -1)
+            continue;
+
+        visit(root);
+        while (!calls.empty()) {
+            auto node = calls.back().first;
+            uns long next;
+            if (calls.back().second.next(next)) {
+                if (indexes[next] == -1)
+                    visit(next);
+                else if (on_stack[next])
+                    lowlinks[node] = std::min(lowlinks[node], indexes[next]);
+                continue;
+            }
+
+            calls.pop_back();
+            if (!calls.empty())
+                lowlinks[calls.back().first] = std::min(lowlinks[calls.back().first], lowlinks[node]);
+
+            if (lowlinks[node] == indexes[node]) {
+                uns long member;
+                do {
+                    member = component_stack.back();
+                    component_stack.pop_back();
+                    on_stack[member] = false;
+                } while (member != node);
+                components++;
+            }
+        }
+    }
+
+    return components;
+}
+
+template <class Arcs>
+unsigned long breadthFirst(Arcs& arcs, size_t nodes_count) {
+    BFS_Result result;
+    BFS_Engine::run(arcs, nodes_count, 0, result);
+    unsigned long reached = 0;
+    for (uns long i = 0; i < nodes_count; i++)
+        reached += result.distances.get(i) != -1;
+    return reached;
+}
+
+template <class F>
+double measure(F&& f, unsigned long& checksum) {
+    double best = 0;
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        checksum = f();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+#include "output.hpp"
+
+// formatted results of read-only queries, reused while the graph stays at the same version.
+// versions only grow, so entries of an older version are dropped once a newer one is seen;
+// queries still running on an older version (server's pinned ones) bypass the cache.
+// least recently used entries are evicted when the cache outgrows its limit in bytes
+
+#define CACHE_BYTES (64ul << 20)
+#define CACHE_ENTRY_OVERHEAD 96     // list node, hash bucket and strings' headers, roughly
+
+class ResultCache {
+private:
+    struct Entry {
+        std::string query;
+        std::string result;
+    };
+
+    std::mutex mutex;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> lookup;   // views into entries' queries
+    uint64_t version = 0;
+    size_t bytes = 0;
+    size_t limit = CACHE_BYTES;
+
+    size_t hits = 0;
+    size_t misses = 0;
+
+    static size_t cost(const Entry& entry) {
+        return entry.query.size() + entry.result.size() + CACHE_ENTRY_OVERHEAD;
+    }
+
+    void evict() {
+        while (bytes > limit && !entries.empty()) {
+            bytes -= cost(entries.back());
+            lookup.erase(entries.back().query);
+            entries.pop_back();
+        }
+    }
+
+    // drops everything computed at an older version, false if curr itself is older
+    bool seeVersion(uint64_t curr) {
+        if (curr == version)
+            return true;
+        if (curr < version)
+            return false;
+
+        version = curr;
+        lookup.clear();
+        entries.clear();
+        bytes = 0;
+        return true;
+    }
+
+public:
+    ResultCache() = default;
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // 0 turns the cache off
+    void setLimit(size_t _) {
+        std::unique_lock<std::mutex> lock(mutex);
+        limit = _;
+        evict();
+    }
+
+    // prints result of the query (command with its arguments), compute() prints it on a miss
+    // and gets recorded. compute runs unlocked, so server's readers don't wait for each other
+    template <class F>
+    void answer(uint64_t curr_version, std::string query, F&& compute) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!seeVersion(curr_version)) {
+                misses++;
+                lock.unlock();
+                compute();
+                return;
+            }
+
+            auto entry = lookup.find(query);
+            if (entry != lookup.end()) {
+                hits++;
+                entries.splice(entries.begin(), entries, entry->second);
+                output << entries.front().result;
+                return;
+            }
+
+            misses++;
+        }
+
+        std::string result;
+        output.recordInto(&result);
+        compute();
+        output.stopRecording();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!seeVersion(curr_version) || lookup.count(query))
+            return;
+
+        entries.push_front({std::move(query), std::move(result)});
+        if (cost(entries.front()) > limit) {
+            entries.pop_front();
+            return;
+        }
+
+        lookup.emplace(entries.front().query, entries.begin());
+        bytes += cost(entries.front());
+        evict();
+    }
+
+    void printStats() {
+        std::unique_lock<std::mutex> lock(mutex);
+        output << "hits " << hits << " misses " << misses << " entries " << entries.size() <<
+        " bytes " << bytes << '\n';
+    }
+};
+
+// shared by the command loop and server's workers
+inline ResultCache query_cache;
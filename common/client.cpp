@@ -0,0 +1,61 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// minimal client of the server mode: stdin lines are sent to the socket,
+// responses are printed as they come. once stdin ends, the sending side is shut down
+// and responses are read until the server closes the connection
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <socket>" << std::endl;
+        return 1;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::string_view path(argv[1]);
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long" << std::endl;
+        return 1;
+    }
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+        std::cerr << "Cannot connect to " << path << std::endl;
+        return 1;
+    }
+
+    std::thread sender([fd] () {
+        std::string input_line;
+        while (getline(std::cin, input_line)) {
+            input_line += '\n';
+
+            size_t written = 0;
+            while (written < input_line.size()) {
+                auto result = send(fd, input_line.data() + written, input_line.size() - written, MSG_NOSIGNAL);
+                if (result <= 0)
+                    return;
+                written += result;
+            }
+        }
+
+        shutdown(fd, SHUT_WR);
+    });
+
+    char buffer[1 << 16];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0)
+        if (::write(STDOUT_FILENO, buffer, count) < 0)
+            break;
+
+    // server closed the connection (e.g. on "exit"), stdin isn't needed anymore
+    sender.detach();
+    close(fd);
+    return 0;
+}
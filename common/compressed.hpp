@@ -0,0 +1,279 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "graph.hpp"
+
+// read-only compact copy of the graph's structure, for graphs which don't fit in memory as
+// Graph's objects. neighbours of every node are sorted by id and stored as varint-encoded gaps
+// (the first one relative to the node itself), so a neighbour mostly takes a byte or two instead
+// of an Edge and a set entry in each direction. weights go to a stream of their own in the same
+// order, traversals which don't need them never read it. lists are indexed in blocks of nodes:
+// a 64-bit offset per block and a 32-bit one per node within it.
+// ids of nodes are the graph's, edges aren't identified (a sorted list loses their order).
+// it's built from passes over a stream of edges, as buildSnapshot (external.hpp) writes a snapshot,
+// so the edges are never held in memory as a whole
+
+#define COMPRESSED_BLOCK_NODES 256
+#define COMPRESSED_BUILD_BYTES (256ul << 20)    // lists gathered per pass of build
+
+class CompressedGraph {
+private:
+    // per-node lists of varints in one buffer
+    struct Lists {
+        std::vector<uint8_t> bytes;
+        std::vector<uint64_t> block_starts;
+        std::vector<uint32_t> starts;       // from block's start, one more for the end of the last list
+
+        const uint8_t* begin(uns long node) const {
+            return bytes.data() + block_starts[node / COMPRESSED_BLOCK_NODES] + starts[node];
+        }
+
+        const uint8_t* end(uns long node) const {
+            return begin(node + 1);
+        }
+
+        // called before node's list is written, and once more after the last one.
+        // false if lists of the node's block outgrew 32-bit starts
+        bool startList(uns long node) {
+            if (node % COMPRESSED_BLOCK_NODES == 0)
+                block_starts.push_back(bytes.size());
+            if (bytes.size() - block_starts.back() > UINT32_MAX)
+                return false;
+
+            starts.push_back(bytes.size() - block_starts.back());
+            return true;
+        }
+
+        void write(uint64_t value) {
+            while (value >= 0x80) {
+                bytes.push_back((uint8_t)(value | 0x80));
+                value >>= 7;
+            }
+            bytes.push_back((uint8_t)value);
+        }
+
+        size_t size() const {
+            return bytes.capacity() + block_starts.capacity() * sizeof(uint64_t) + starts.capacity() * sizeof(uint32_t);
+        }
+    };
+
+    typedef std::pair<uns long, EDGE_WEIGHT_T> Neighbour;
+
+    size_t nodes_count = 0;
+    size_t edges_count = 0;
+    Lists out, in, weights;
+
+    static uint64_t read(const uint8_t*& pos) {
+        if (*pos < 0x80)
+            return *pos++;
+
+        uint64_t value = 0;
+        unsigned shift = 0;
+        uint8_t byte;
+        do {
+            byte = *pos++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return value;
+    }
+
+    // neighbours sorted by id, with their weights if weights_list is set
+    static bool encode(uns long node, Neighbour* begin, Neighbour* end, Lists& list, Lists* weights_list) {
+        std::sort(begin, end);
+
+        if (!list.startList(node) || (weights_list && !weights_list->startList(node)))
+            return false;
+
+        uns long last = node;
+        for (auto i = begin; i != end; i++) {
+            auto neighbour = i->first;
+            // the first one may be below the node, zigzag keeps small differences short either way
+            if (i == begin) {
+                int64_t difference = (int64_t)neighbour - (int64_t)node;
+                list.write(((uint64_t)difference << 1) ^ (uint64_t)(difference >> 63));
+            } else
+                list.write(neighbour - last);
+            last = neighbour;
+
+            if (weights_list)
+                weights_list->write(i->second);
+        }
+        return true;
+    }
+
+public:
+    // decodes one node's list: next() gives neighbours in increasing order
+    class Cursor {
+    private:
+        const uint8_t* pos;
+        const uint8_t* end;
+        const uint8_t* weight_pos;
+        uns long last;
+        bool first = true;
+
+    public:
+        Cursor(const uint8_t* pos, const uint8_t* end, const uint8_t* weight_pos, uns long node)
+            : pos(pos), end(end), weight_pos(weight_pos), last(node) {}
+
+        bool next(uns long& neighbour) {
+            if (pos == end)
+                return false;
+
+            auto value = read(pos);
+            if (first) {
+                last += (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+                first = false;
+            } else
+                last += value;
+
+            neighbour = last;
+            return true;
+        }
+
+        // only for successors(node, true)
+        bool next(uns long& neighbour, EDGE_WEIGHT_T& weight) {
+            if (!next(neighbour))
+                return false;
+
+            weight = (EDGE_WEIGHT_T)read(weight_pos);
+            return true;
+        }
+    };
+
+    CompressedGraph() = default;
+
+    // edges(emit) calls emit(src, drain, weight) for every edge, the same edges in the same order
+    // each time, ends are ids below nodes_count. it's called once to count degrees, then per direction
+    // once per range of nodes whose lists fit memory_bytes, so apart from that only per-node arrays
+    // are held. false if a block's lists are too long to be indexed (over 4 GiB)
+    template <class Edges>
+    static bool build(CompressedGraph& graph, size_t nodes_count, Edges&& edges,
+                      size_t memory_bytes = COMPRESSED_BUILD_BYTES) {
+        graph = CompressedGraph();
+        graph.nodes_count = nodes_count;
+
+        // where each node's list starts among all lists of a direction
+        std::vector<uint64_t> out_first(nodes_count + 1, 0);
+        std::vector<uint64_t> in_first(nodes_count + 1, 0);
+        edges([&out_first, &in_first] (uns long src, uns long drain, EDGE_WEIGHT_T) {
+            out_first[src + 1]++;
+            in_first[drain + 1]++;
+        });
+        for (size_t i = 0; i < nodes_count; i++) {
+            out_first[i + 1] += out_first[i];
+            in_first[i + 1] += in_first[i];
+        }
+        graph.edges_count = out_first[nodes_count];
+
+        auto capacity = std::max((size_t)1, memory_bytes / sizeof(Neighbour));
+        std::vector<Neighbour> neighbours;
+        std::vector<uint64_t> position(nodes_count);
+
+        for (int direction = 0; direction < 2; direction++) {
+            auto& first = direction ? in_first : out_first;
+            auto& list = direction ? graph.in : graph.out;
+            auto weights_list = direction ? nullptr : &graph.weights;
+
+            // a range takes one node at least, however long its list is
+            for (uns long begin = 0; begin < nodes_count; ) {
+                uns long end = begin + 1;
+                while (end < nodes_count && first[end + 1] - first[begin] <= capacity)
+                    end++;
+
+                neighbours.resize(first[end] - first[begin]);
+                std::copy(first.begin() + begin, first.begin() + end, position.begin() + begin);
+                edges([&] (uns long src, uns long drain, EDGE_WEIGHT_T weight) {
+                    auto node = direction ? drain : src;
+                    if (node >= begin && node < end)
+                        neighbours[position[node]++ - first[begin]] = {direction ? src : drain, weight};
+                });
+
+                for (auto node = begin; node < end; node++)
+                    if (!encode(node, neighbours.data() + (first[node] - first[begin]),
+                                neighbours.data() + (first[node + 1] - first[begin]), list, weights_list))
+                        return false;
+
+                begin = end;
+            }
+
+            if (!list.startList(nodes_count) || (weights_list && !weights_list->startList(nodes_count)))
+                return false;
+        }
+
+        for (auto list : {&graph.out, &graph.in, &graph.weights}) {
+            list->bytes.shrink_to_fit();
+            list->block_starts.shrink_to_fit();
+            list->starts.shrink_to_fit();
+        }
+        return true;
+    }
+
+    static bool fromGraph(CompressedGraph& compressed, Graph& graph) {
+        return build(compressed, graph.getNodesCount(), [&graph] (auto&& emit) {
+            for (uns long i = 0; i < graph.getEdgesCount(); i++) {
+                auto edge = graph.getEdge(i);
+                emit(edge->getSrc()->getId(), edge->getDrain()->getId(), edge->getWeight());
+            }
+        });
+    }
+
+    size_t getNodesCount() const {
+        return nodes_count;
+    }
+
+    size_t getEdgesCount() const {
+        return edges_count;
+    }
+
+    // weights are decoded along if with_weights is set
+    Cursor successors(uns long node, bool with_weights = false) const {
+        return Cursor(out.begin(node), out.end(node), with_weights ? weights.begin(node) : nullptr, node);
+    }
+
+    Cursor predecessors(uns long node) const {
+        return Cursor(in.begin(node), in.end(node), nullptr, node);
+    }
+
+    // every varint ends with a byte below 0x80, so they're counted without decoding
+    size_t outDegree(uns long node) const {
+        return std::count_if(out.begin(node), out.end(node), [] (uint8_t byte) { return byte < 0x80; });
+    }
+
+    // memory held, in bytes
+    size_t size() const {
+        return sizeof(*this) + out.size() + in.size() + weights.size();
+    }
+};
+
+// BFS_Engine's traversal (see 1.3/bfs.hpp) over the compressed graph, arcs are -1
+struct CompressedArcs {
+    const CompressedGraph& graph;
+
+    template <class F>
+    void successors(uns long node, F&& f) {
+        auto cursor = graph.successors(node);
+        for (uns long next; cursor.next(next); )
+            if (f(next, -1l))
+                return;
+    }
+
+    template <class F>
+    void predecessors(uns long node, F&& f) {
+        auto cursor = graph.predecessors(node);
+        for (uns long next; cursor.next(next); )
+            if (f(next, -1l))
+                return;
+    }
+
+    size_t degree(uns long node) {
+        return graph.outDegree(node);
+    }
+
+    size_t arcsCount() {
+        return graph.getEdgesCount();
+    }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define DENSE_AVX2
+#endif
+
+#include "graph.hpp"
+
+// bit-matrix layout of small dense graphs: row i of the out matrix has bit j set if there's an
+// edge i -> j, in matrix is its transpose, and weights keep the lightest of parallel edges.
+// a row is a few hundred words, so a node's neighbours are found by word operations
+// (AVX2 where the CPU has it) instead of walking a set of edges. algorithms whose results don't
+// depend on the order of adjacency (BFS, DIJKSTRA, COMPONENTS) switch to it by themselves
+// once the graph is dense enough; the graph stays as it is, the matrices are built per version.
+// TARJAN isn't among them: its output follows adjacency order, so it would walk the edges anyway
+
+#define DENSE_MIN_NODES 64
+#define DENSE_MAX_NODES 4096            // weights take 4 bytes per pair of nodes
+#define DENSE_DENSITY_DIVISOR 8         // at least nodes^2 / 8 edges
+
+// word kernels over rows, dispatched once by the CPU's features
+#ifdef DENSE_AVX2
+__attribute__((target("avx2"))) inline void orWordsAVX2(uint64_t* target, const uint64_t* source, size_t words) {
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        auto lhs = _mm256_loadu_si256((const __m256i*)(target + i));
+        auto rhs = _mm256_loadu_si256((const __m256i*)(source + i));
+        _mm256_storeu_si256((__m256i*)(target + i), _mm256_or_si256(lhs, rhs));
+    }
+    for (; i < words; i++)
+        target[i] |= source[i];
+}
+
+__attribute__((target("avx2"))) inline bool intersectAVX2(const uint64_t* lhs, const uint64_t* rhs, size_t words) {
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        auto a = _mm256_loadu_si256((const __m256i*)(lhs + i));
+        auto b = _mm256_loadu_si256((const __m256i*)(rhs + i));
+        if (!_mm256_testz_si256(a, b))
+            return true;
+    }
+    for (; i < words; i++)
+        if (lhs[i] & rhs[i])
+            return true;
+    return false;
+}
+
+inline bool hasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+// target |= source
+inline void orWords(uint64_t* target, const uint64_t* source, size_t words) {
+#ifdef DENSE_AVX2
+    if (hasAVX2())
+        return orWordsAVX2(target, source, words);
+#endif
+    for (size_t i = 0; i < words; i++)
+        target[i] |= source[i];
+}
+
+// true if the rows share a bit
+inline bool intersect(const uint64_t* lhs, const uint64_t* rhs, size_t words) {
+#ifdef DENSE_AVX2
+    if (hasAVX2())
+        return intersectAVX2(lhs, rhs, words);
+#endif
+    for (size_t i = 0; i < words; i++)
+        if (lhs[i] & rhs[i])
+            return true;
+    return false;
+}
+
+// f(bit) for every set bit of the row, in increasing order
+template <class F>
+void forEachBit(const uint64_t* row, size_t words, F&& f) {
+    for (size_t w = 0; w < words; w++)
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1)
+            f(w * 64 + __builtin_ctzll(bits));
+}
+
+// describes one version of the graph and isn't changed once built (see DenseGraphs)
+class DenseGraph {
+private:
+    uint64_t version = 0;
+    size_t nodes_count = 0;
+    size_t row_words = 0;
+    std::vector<uint64_t> out;
+    std::vector<uint64_t> in;
+    std::vector<EDGE_WEIGHT_T> weights;     // meaningful where out has the bit
+
+public:
+    static bool suits(Graph& graph) {
+        auto count = graph.getNodesCount();
+        return count >= DENSE_MIN_NODES && count <= DENSE_MAX_NODES &&
+               graph.getEdgesCount() * DENSE_DENSITY_DIVISOR >= count * count;
+    }
+
+    explicit DenseGraph(Graph& graph) : version(graph.getVersion()), nodes_count(graph.getNodesCount()) {
+        row_words = (nodes_count + 63) / 64;
+        out.assign(nodes_count * row_words, 0);
+        in.assign(nodes_count * row_words, 0);
+        weights.assign(nodes_count * nodes_count, std::numeric_limits<EDGE_WEIGHT_T>::max());
+
+        for (uns long i = 0; i < graph.getEdgesCount(); i++) {
+            auto edge = graph.getEdge(i);
+            auto src = edge->getSrc()->getId();
+            auto drain = edge->getDrain()->getId();
+
+            out[src * row_words + (drain >> 6)] |= 1ull << (drain & 63);
+            in[drain * row_words + (src >> 6)] |= 1ull << (src & 63);
+            weights[src * nodes_count + drain] = std::min(weights[src * nodes_count + drain], edge->getWeight());
+        }
+    }
+
+    uint64_t getVersion() const {
+        return version;
+    }
+
+    size_t getNodesCount() const {
+        return nodes_count;
+    }
+
+    size_t rowWords() const {
+        return row_words;
+    }
+
+    const uint64_t* outRow(uns long node) const {
+        return out.data() + node * row_words;
+    }
+
+    const uint64_t* inRow(uns long node) const {
+        return in.data() + node * row_words;
+    }
+
+    // lightest edge src -> drain, there must be one
+    EDGE_WEIGHT_T weight(uns long src, uns long drain) const {
+        return weights[src * nodes_count + drain];
+    }
+};
+
+// matrices of the latest dense version queried, built by the first query which needs them.
+// as ReachabilityIndexes, queries keep the matrices they got, older versions get their own
+class DenseGraphs {
+private:
+    std::atomic<bool> enabled{true};
+    std::mutex mutex;
+    std::mutex build_mutex;
+    std::shared_ptr<const DenseGraph> latest;
+
+    std::shared_ptr<const DenseGraph> find(uint64_t version) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (latest && latest->getVersion() == version)
+            return latest;
+        return nullptr;
+    }
+
+public:
+    // off, every graph is left to adjacency sets (--dense 0, tests compare both)
+    void setEnabled(bool value) {
+        enabled = value;
+    }
+
+    // nullptr if the graph isn't dense
+    std::shared_ptr<const DenseGraph> forGraph(Graph& graph) {
+        if (!enabled || !DenseGraph::suits(graph))
+            return nullptr;
+
+        if (auto dense = find(graph.getVersion()))
+            return dense;
+
+        std::unique_lock<std::mutex> build_lock(build_mutex);
+        if (auto dense = find(graph.getVersion()))
+            return dense;
+
+        auto dense = std::make_shared<const DenseGraph>(graph);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!latest || latest->getVersion() < dense->getVersion())
+            latest = dense;
+        return dense;
+    }
+};
+
+// shared by everything in the process
+inline DenseGraphs dense_graphs;
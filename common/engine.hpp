@@ -0,0 +1,530 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "registry.hpp"
+#include "tokenizer.hpp"
+#include "ingest.hpp"
+#include "snapshot.hpp"
+#include "wal.hpp"
+#include "server.hpp"
+#include "pipeline.hpp"
+#include "batch.hpp"
+#include "cache.hpp"
+#include "pool.hpp"
+#include "versions.hpp"
+#include "reorder.hpp"
+#include "external.hpp"
+#include "sharded.hpp"
+#include "dense.hpp"
+
+// command loop and process setup shared by every binary: each task's main registers its
+// algorithms and calls runEngine, the engine binary registers all of them.
+// mutations, persistence and CACHE_STATS are built in, the rest is looked up in the registry
+
+// walks the line the way the command loop does; unknown tokens are skipped by it, so they're harmless
+inline bool isReadOnly(const AlgorithmRegistry& registry, std::string_view line) {
+    Tokenizer request(line);
+
+    while (!request.empty()) {
+        auto command = request.front();
+        if (command == "NODE" || command == "EDGE" || command == "REMOVE" || command == "LOAD" ||
+            command == "CHECKPOINT" || command == "BEGIN" || command == "COMMIT" || command == "REORDER")
+            return false;
+
+        size_t arguments = command == "SAVE";
+        auto algorithm = registry.find(command);
+        if (algorithm && algorithm->parse) {
+            request.pop();
+            algorithm->parse(nullptr, request);
+            continue;
+        }
+        if (algorithm)
+            arguments = algorithm->words - 1 + algorithm->arity;
+
+        request.pop();
+        for (size_t i = 0; i < arguments; i++)
+            request.pop();
+    }
+
+    return true;
+}
+
+// resolves marks of algorithm's arguments, reports the unknown ones the way commands always did:
+// all of them at once if none exists, otherwise the first one
+inline bool findNodes(Graph& graph, const std::string_view* marks, size_t count, Node** nodes) {
+    size_t unknown = 0;
+    for (size_t i = 0; i < count; i++)
+        unknown += !(nodes[i] = graph.getNode(marks[i]));
+
+    if (!unknown)
+        return true;
+
+    if (count > 1 && unknown == count) {
+        output << "Unknown nodes";
+        for (size_t i = 0; i < count; i++)
+            output << " " << marks[i];
+        output << '\n';
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        if (!nodes[i]) {
+            output << "Unknown node " << marks[i] << '\n';
+            break;
+        }
+
+    return false;
+}
+
+// once the log couldn't be written, the graph would get further ahead of what can be
+// recovered, so mutations are refused (CHECKPOINT starts a new log)
+inline bool refuseMutation() {
+    if (!mutation_log.hasFailed())
+        return false;
+
+    output << "Log write failed" << '\n';
+    return true;
+}
+
+// runs every command found in the line
+inline void executeLine(Graph& graph, MutationBatch<Graph>& batch, const AlgorithmRegistry& registry,
+                        std::string_view input_line) {
+    // tokens are views over input_line
+    Tokenizer request(input_line);
+
+    while (!request.empty()) {
+        // mutations go to the batch, it applies them at once when their run ends
+        if (request.front() == "NODE") {
+            request.pop();
+            auto mark = request.front();
+            request.pop();
+
+            if (refuseMutation())
+                continue;
+            batch.addNode(graph, mark);
+            // output << "Created node"<< '\n';
+            continue;
+        }
+
+        if (request.front() == "EDGE") {
+            request.pop();
+            auto src_name = request.front();
+            auto src = batch.find(graph, src_name);
+            request.pop();
+            auto drain_name = request.front();
+            auto drain = batch.find(graph, drain_name);
+            request.pop();
+
+            EDGE_WEIGHT_T weight;
+            if (!parseNumber(request.front(), weight)) {
+                output << "Invalid weight " << request.front() << '\n';
+                request.pop();
+                continue;
+            }
+            request.pop();
+
+            if (refuseMutation())
+                continue;
+            if (src < 0 && drain < 0) {
+                output << "Unknown nodes " << src_name << " " << drain_name << '\n';
+                continue;
+            } else if (src < 0) {
+                output << "Unknown node " << src_name << '\n';
+                continue;
+            } else if (drain < 0) {
+                output << "Unknown node " << drain_name << '\n';
+                continue;
+            }
+
+            batch.addEdge(src, drain, weight);
+            // output << "Created edge" << '\n';
+            continue;
+        }
+
+        if (request.front() == "REMOVE") {
+            request.pop();
+
+            // the rest of the line lists a set of nodes, the batch removes them all in one pass.
+            // a node listed again is skipped (tokens are views over the line, so they outlive the set)
+            if (request.front() == "NODES") {
+                request.pop();
+                if (refuseMutation())
+                    while (!request.empty())
+                        request.pop();
+
+                std::unordered_set<std::string_view> listed;
+                while (!request.empty()) {
+                    auto target = request.front();
+                    request.pop();
+                    if (!listed.insert(target).second)
+                        continue;
+
+                    auto node = batch.find(graph, target);
+                    if (node < 0) {
+                        output << "Unknown node " << target << '\n';
+                        continue;
+                    }
+                    batch.removeNode(graph, node);
+                }
+            }
+
+            else if (request.front() == "NODE") {
+                request.pop();
+                auto target = request.front();
+                request.pop();
+
+                if (refuseMutation())
+                    continue;
+                auto node = batch.find(graph, target);
+                if (node < 0) {
+                    output << "Unknown node " << target << '\n';
+                    continue;
+                }
+                batch.removeNode(graph, node);
+                // output << "Removed node" << '\n';
+            }
+
+            else if (request.front() == "EDGE") {
+                request.pop();
+
+                auto src_name = request.front();
+                auto src = batch.find(graph, src_name);
+                request.pop();
+                auto drain_name = request.front();
+                auto drain = batch.find(graph, drain_name);
+                request.pop();
+
+                if (refuseMutation())
+                    continue;
+                if (src < 0 && drain < 0) {
+                    output << "Unknown nodes " << src_name << " " << drain_name << '\n';
+                    continue;
+                } else if (src < 0) {
+                    output << "Unknown node " << src_name << '\n';
+                    continue;
+                } else if (drain < 0) {
+                    output << "Unknown node " << drain_name << '\n';
+                    continue;
+                }
+
+                batch.removeEdge(graph, src, drain);
+                // output << "Removed edge" << '\n';
+
+            }
+            continue;
+        }
+
+        if (request.front() == "BEGIN") {
+            request.pop();
+            batch.begin();
+            continue;
+        }
+
+        if (request.front() == "COMMIT") {
+            request.pop();
+            batch.commit();
+            batch.apply(graph);
+            continue;
+        }
+
+        // the rest reads the graph, so the run of mutations ends here.
+        // inside a transaction reads see the graph as it was at BEGIN
+        if (!batch.inTransaction())
+            batch.apply(graph);
+
+        if (auto algorithm = registry.find(request.front())) {
+            if (algorithm->parse) {
+                request.pop();
+                algorithm->parse(&graph, request);
+                continue;
+            }
+
+            // rest of a multi-word name, e.g. MAX's FLOW
+            std::string query(algorithm->name);
+            for (size_t i = 0; i < algorithm->words; i++)
+                request.pop();
+
+            std::string_view marks[ALGORITHM_MAX_ARITY];
+            Node* nodes[ALGORITHM_MAX_ARITY];
+            for (size_t i = 0; i < algorithm->arity; i++) {
+                marks[i] = request.front();
+                request.pop();
+                query += ' ';
+                query += marks[i];
+            }
+
+            if (!findNodes(graph, marks, algorithm->arity, nodes))
+                continue;
+
+            if (algorithm->cached)
+                query_cache.answer(graph.getVersion(), std::move(query), [&] () {
+                    algorithm->run(graph, nodes);
+                });
+            else
+                algorithm->run(graph, nodes);
+            continue;
+        }
+
+        if (request.front() == "CACHE_STATS") {
+            request.pop();
+            query_cache.printStats();
+            continue;
+        }
+
+        if (request.front() == "SAVE") {
+            request.pop();
+            std::string path(request.front());
+            request.pop();
+
+            if (saveSnapshot(graph, path) != SnapshotResult::Done)
+                output << "Cannot write " << path << '\n';
+            continue;
+        }
+
+        if (request.front() == "LOAD") {
+            request.pop();
+            std::string path(request.front());
+            request.pop();
+
+            // pending changes are committed before the graph is replaced
+            batch.apply(graph);
+            auto result = loadSnapshot(graph, path);
+            if (result == SnapshotResult::Failed)
+                output << "Cannot read " << path << '\n';
+            else if (result == SnapshotResult::Corrupted)
+                output << "Corrupted snapshot " << path << '\n';
+
+            // log can't describe a replaced graph, so it starts over from it
+            else if (mutation_log.isOpen() && !mutation_log.checkpoint(graph))
+                output << "Cannot write " << mutation_log.snapshotPath() << '\n';
+            continue;
+        }
+
+        if (request.front() == "CHECKPOINT") {
+            request.pop();
+            batch.apply(graph);
+
+            if (!mutation_log.isOpen())
+                output << "Mutation log is off" << '\n';
+            else if (!mutation_log.checkpoint(graph))
+                output << "Cannot write " << mutation_log.snapshotPath() << '\n';
+            continue;
+        }
+
+        if (request.front() == "REORDER") {
+            request.pop();
+            auto strategy = request.front();
+            request.pop();
+
+            // pending changes refer to ids, so they're committed first
+            batch.apply(graph);
+            std::vector<uns long> order;
+            if (!nodeOrder(graph, strategy, order)) {
+                output << "Unknown strategy " << strategy << '\n';
+                continue;
+            }
+            graph.reorder(order);
+
+            // replaying the log wouldn't give nodes the new ids, so it starts over from the graph
+            if (mutation_log.isOpen() && !mutation_log.checkpoint(graph))
+                output << "Cannot write " << mutation_log.snapshotPath() << '\n';
+            continue;
+        }
+
+        request.pop(); // if command is undefined
+    }
+}
+
+// parses options and runs commands from --input, stdin or the socket
+inline int runEngine(int argc, char** argv, const AlgorithmRegistry& registry) {
+    std::string input_line;
+    const char* input_path = nullptr;
+    const char* log_path = nullptr;
+    size_t log_records = LOG_GROUP_RECORDS;
+    size_t log_ms = LOG_GROUP_MS;
+    const char* serve_path = nullptr;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t cache_bytes = CACHE_BYTES;
+    size_t threads = thread_pool.getThreads();
+    const char* external_path = nullptr;
+    size_t shards = 2;
+    size_t dense = 1;
+
+    // --interactive flushes output after every command instead of by blocks,
+    // --input <file> reads commands from the file instead of stdin,
+    // --log <file> recovers graph from the mutation log and keeps logging into it,
+    // --log-records <n> and --log-ms <n> set how large log's commit groups get,
+    // --serve <socket> keeps the graph resident and answers clients instead of stdin,
+    // --workers <n> sets how many lines the server executes at once,
+    // --cache-bytes <n> limits the query result cache (0 turns it off),
+    // --threads <n> sets how many threads parallel algorithms and ingest use,
+    // --external <snapshot> answers queries right from the snapshot on disk (see external.hpp),
+    // --shards <n> sets how many worker processes SHARDED_ queries split the graph between,
+    // --dense 0 keeps dense graphs off bit matrices (see dense.hpp)
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view(argv[i]) == "--interactive")
+            output.setInteractive(true);
+        else if (std::string_view(argv[i]) == "--input" && i + 1 < argc)
+            input_path = argv[++i];
+        else if (std::string_view(argv[i]) == "--log" && i + 1 < argc)
+            log_path = argv[++i];
+        else if (std::string_view(argv[i]) == "--log-records" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), log_records);
+        else if (std::string_view(argv[i]) == "--log-ms" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), log_ms);
+        else if (std::string_view(argv[i]) == "--serve" && i + 1 < argc)
+            serve_path = argv[++i];
+        else if (std::string_view(argv[i]) == "--workers" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), workers);
+        else if (std::string_view(argv[i]) == "--cache-bytes" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), cache_bytes);
+        else if (std::string_view(argv[i]) == "--threads" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), threads);
+        else if (std::string_view(argv[i]) == "--external" && i + 1 < argc)
+            external_path = argv[++i];
+        else if (std::string_view(argv[i]) == "--shards" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), shards);
+        else if (std::string_view(argv[i]) == "--dense" && i + 1 < argc)
+            parseNumber(std::string_view(argv[++i]), dense);
+    }
+
+    if (external_path)
+        return runExternal(external_path);
+
+    // output << "Type \"exit\" to exit" << '\n';
+
+    // graph initialization, server keeps versions of it (see versions.hpp)
+    auto first_version = std::make_shared<Graph>();
+    Graph& graph = *first_version;
+    MutationBatch<Graph> batch;
+
+    query_cache.setLimit(cache_bytes);
+    thread_pool.setThreads(threads);
+    sharded_engine.setWorkers(shards);
+    dense_graphs.setEnabled(dense);
+    mutation_log.setGroup(log_records, log_ms);
+    if (log_path && !mutation_log.open(graph, log_path)) {
+        output << "Cannot open log " << log_path << '\n';
+        output.flush();
+        return 1;
+    }
+
+    // --input and piped stdin apply NODE/EDGE runs in bulk, the rest goes through the command loop
+    auto execute = [&graph, &batch, &registry] (std::string_view line) {
+        executeLine(graph, batch, registry, line);
+        output.endCommand();
+    };
+    auto logBuild = [&graph, &batch] (const std::vector<Graph::BuildCommand>& commands) {
+        if (mutation_log.hasFailed()) {
+            for (size_t i = 0; i < commands.size(); i++)
+                refuseMutation();
+            return false;
+        }
+
+        // a transaction defers bulk runs as well
+        if (batch.inTransaction()) {
+            batch.bulkBuild(graph, commands);
+            return false;
+        }
+
+        batch.apply(graph);
+        for (auto& i : commands)
+            i.is_edge ? mutation_log.edge(i.src, i.drain, i.weight) : mutation_log.node(i.src);
+        return true;
+    };
+
+    // pending mutations are applied (and logged) before the log is closed,
+    // an unfinished transaction is dropped
+    auto shutdown = [&graph, &batch] () {
+        if (!batch.inTransaction())
+            batch.apply(graph);
+        mutation_log.close();
+        output.flush();
+    };
+
+    if (input_path) {
+        auto result = ingestFile(graph, input_path, execute, logBuild);
+
+        if (result == IngestResult::Failed)
+            output << "Cannot read " << input_path << '\n';
+        else if (result == IngestResult::Exit)
+            output << "exitting...";
+
+        // a served graph can be preloaded from the file
+        if (result != IngestResult::Done || !serve_path) {
+            shutdown();
+            return result == IngestResult::Failed;
+        }
+    }
+
+    if (serve_path) {
+        // clients see each other's changes once a line is done, transactions don't outlive it
+        batch.commit();
+        batch.apply(graph);
+
+        GraphVersions<Graph> versions(std::move(first_version));
+        std::mutex write_mutex;
+        Server server;
+        output.flush();
+
+        bool served = server.run(serve_path, workers, [&versions, &write_mutex, &batch, &registry] (std::string_view line) {
+            // queries keep the version they started with, nothing is applied by them
+            if (isReadOnly(registry, line)) {
+                static thread_local MutationBatch<Graph> no_mutations;
+                line_version<Graph> = versions.pin();
+                executeLine(*line_version<Graph>, no_mutations, registry, line);
+                line_version<Graph>.reset();
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock(write_mutex);
+            auto writable = versions.beginWrite();
+            executeLine(*writable, batch, registry, line);
+            if (batch.inTransaction())
+                batch.commit();
+            batch.apply(*writable);
+            versions.endWrite(std::move(writable));
+        });
+
+        if (!served)
+            output << "Cannot listen on " << serve_path << '\n';
+
+        // every line applied its mutations, and graph may be an old version by now
+        mutation_log.close();
+        output.flush();
+        return !served;
+    }
+
+    // interactive sessions keep the sequential loop, there's nothing to overlap a command with
+    if (!output.isInteractive()) {
+        if (ingestStream(graph, STDIN_FILENO, execute, logBuild) == IngestResult::Exit)
+            output << "exitting...";
+
+        shutdown();
+        return 0;
+    }
+
+    while (std::getline(std::cin, input_line)) {
+        if (input_line == "exit") {
+            output << "exitting...";
+            shutdown();
+            return 0;
+        }
+
+        executeLine(graph, batch, registry, input_line);
+        output.endCommand();
+
+        // typed commands take effect right away
+        if (!batch.inTransaction())
+            batch.apply(graph);
+    }
+
+    shutdown();
+    return 0;
+}
+
+
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "graph.hpp"
+#include "snapshot.hpp"
+#include "output.hpp"
+#include "tokenizer.hpp"
+#include "scratch.hpp"
+
+// external-memory mode (--external <snapshot>): queries run right on a snapshot (see snapshot.hpp)
+// mapped from disk, its CSR is used as it is. only per-node arrays (marks' index, distances, ...)
+// are kept in memory, so graphs many times larger than it are answered, with the page cache
+// holding whatever part of the file fits.
+// the file is read in blocks of EXTERNAL_BLOCK_BYTES. BFS expands a level by reading frontier's
+// lists in id order, so every level streams the edges forward at most once and the next block
+// is requested ahead. RPO_NUMBERING and TARJAN print in DFS order, which follows edges wherever
+// they go, so they read lists at random with readahead off. EXTERNAL_STATS tells how much was read.
+// answers are the same as after LOAD of the snapshot.
+// buildSnapshot writes a snapshot from a stream of edges in passes which fit a memory budget,
+// for graphs which can't be loaded to be SAVEd
+
+#define EXTERNAL_BLOCK_BYTES (1ul << 20)
+#define EXTERNAL_BUILD_BYTES (256ul << 20)     // edge arrays filled per pass of buildSnapshot
+
+typedef EDGE_WEIGHT_T ExternalWeight;
+
+class ExternalGraph {
+private:
+    char* data = nullptr;
+    size_t size = 0;
+    SnapshotHeader header{};
+
+    const uint64_t* mark_offsets = nullptr;
+    const char* marks = nullptr;
+    const uint64_t* offsets = nullptr;
+    const uint64_t* targets = nullptr;
+
+    // marks -> ids, nodes are assumed to fit in memory
+    std::unordered_map<std::string_view, uint64_t> index;
+
+    // I/O accounting: blocks of edges streamed by BFS, lists read at random by DFS
+    size_t streamed_blocks = 0;
+    size_t random_lists = 0;
+    size_t requested_block = 0;    // BFS's readahead, blocks below it were requested already
+
+    void advise(const void* begin, size_t bytes, int advice) {
+        auto page = (uintptr_t)begin & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+        madvise((void*)page, (uintptr_t)begin + bytes - page, advice);
+    }
+
+public:
+    ExternalGraph() = default;
+
+    ExternalGraph(const ExternalGraph&) = delete;
+    ExternalGraph& operator=(const ExternalGraph&) = delete;
+
+    ~ExternalGraph() {
+        if (data)
+            munmap(data, size);
+    }
+
+    // checks the header and the per-node arrays, edges aren't read: a check of every target
+    // would be a pass over the whole file, so targets out of range are skipped when they're read
+    SnapshotResult open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return SnapshotResult::Failed;
+
+        struct stat info;
+        if (fstat(fd, &info) < 0) {
+            close(fd);
+            return SnapshotResult::Failed;
+        }
+        if ((size_t)info.st_size < sizeof(SnapshotHeader)) {
+            close(fd);
+            return SnapshotResult::Corrupted;
+        }
+
+        size = info.st_size;
+        data = (char*)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            return SnapshotResult::Failed;
+        }
+
+        std::memcpy(&header, data, sizeof(header));
+        size_t sizes[SNAPSHOT_SECTIONS] = {(header.nodes_count + 1) * sizeof(uint64_t), header.marks_bytes,
+                                           (header.nodes_count + 1) * sizeof(uint64_t),
+                                           header.edges_count * sizeof(uint64_t), header.edges_count * sizeof(ExternalWeight)};
+        const char* sections[SNAPSHOT_SECTIONS];
+        size_t expected_size = sizeof(header);
+        for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++) {
+            sections[i] = data + expected_size;
+            expected_size += alignSection(sizes[i]);
+        }
+
+        bool valid = std::memcmp(header.magic, SNAPSHOT_MAGIC, 8) == 0 && header.version == SNAPSHOT_VERSION &&
+                     header.weight_size == sizeof(ExternalWeight) &&
+                     header.header_checksum == snapshotChecksum(&header, offsetof(SnapshotHeader, header_checksum)) &&
+                     expected_size == size;
+        if (!valid)
+            return SnapshotResult::Corrupted;
+
+        mark_offsets = (const uint64_t*)sections[0];
+        marks = sections[1];
+        offsets = (const uint64_t*)sections[2];
+        targets = (const uint64_t*)sections[3];
+
+        for (uint64_t i = 0; valid && i < header.nodes_count; i++)
+            valid = mark_offsets[i] <= mark_offsets[i + 1] && mark_offsets[i + 1] <= header.marks_bytes &&
+                    offsets[i] <= offsets[i + 1] && offsets[i + 1] <= header.edges_count;
+        if (!valid)
+            return SnapshotResult::Corrupted;
+
+        index.reserve(header.nodes_count);
+        for (uint64_t i = 0; i < header.nodes_count; i++)
+            index.emplace(mark(i), i);
+        return SnapshotResult::Done;
+    }
+
+    size_t getNodesCount() const {
+        return header.nodes_count;
+    }
+
+    size_t getEdgesCount() const {
+        return header.edges_count;
+    }
+
+    // -1 if there's no such node
+    long find(std::string_view mark) const {
+        auto node = index.find(mark);
+        return node == index.end() ? -1 : (long)node->second;
+    }
+
+    std::string_view mark(uint64_t node) const {
+        return std::string_view(marks + mark_offsets[node], mark_offsets[node + 1] - mark_offsets[node]);
+    }
+
+    // f(drain) for node's edges in their order
+    template <class F>
+    void forEachTarget(uint64_t node, F&& f) const {
+        for (auto e = offsets[node]; e < offsets[node + 1]; e++)
+            if (targets[e] < header.nodes_count)
+                f(targets[e]);
+    }
+
+    // read positions [begin, end) of edges
+    uint64_t listBegin(uint64_t node) const {
+        return offsets[node];
+    }
+
+    uint64_t listEnd(uint64_t node) const {
+        return offsets[node + 1];
+    }
+
+    uint64_t target(uint64_t position) const {
+        return targets[position];
+    }
+
+// access patterns
+public:
+    // lists are going to be read in increasing order of nodes
+    void startStreaming() {
+        advise(offsets, (header.nodes_count + 1) * sizeof(uint64_t), MADV_SEQUENTIAL);
+        advise(targets, header.edges_count * sizeof(uint64_t), MADV_SEQUENTIAL);
+        requested_block = 0;
+    }
+
+    // node's list is about to be read by a stream, the block after it is requested ahead
+    void streamTo(uint64_t node) {
+        auto block = offsets[node + 1] * sizeof(uint64_t) / EXTERNAL_BLOCK_BYTES;
+        if (block < requested_block)
+            return;
+
+        auto first = std::max(requested_block, offsets[node] * sizeof(uint64_t) / EXTERNAL_BLOCK_BYTES);
+        streamed_blocks += block + 1 - first;
+        requested_block = block + 2;
+
+        auto ahead = (block + 1) * EXTERNAL_BLOCK_BYTES;
+        auto end = header.edges_count * sizeof(uint64_t);
+        if (ahead < end)
+            advise((const char*)targets + ahead, std::min(EXTERNAL_BLOCK_BYTES, end - ahead), MADV_WILLNEED);
+    }
+
+    // a level of a stream is over, the next one starts from the beginning
+    void restartStream() {
+        requested_block = 0;
+    }
+
+    // lists are going to be read in whatever order edges lead
+    void startRandom() {
+        advise(offsets, (header.nodes_count + 1) * sizeof(uint64_t), MADV_RANDOM);
+        advise(targets, header.edges_count * sizeof(uint64_t), MADV_RANDOM);
+    }
+
+    // the mapping gives its pages back, whatever isn't in the page cache is read again
+    void evict() {
+        madvise(data, size, MADV_DONTNEED);
+    }
+
+    void countRandomList() {
+        random_lists++;
+    }
+
+    void printStats() const {
+        output << "streamed blocks " << streamed_blocks << " random lists " << random_lists << '\n';
+    }
+};
+
+// arrays of the queries, kept between them (see scratch.hpp)
+struct ExternalScratch {
+    StampedArray<long> distances;
+    std::vector<uint64_t> frontier, next;
+    StampedArray<Color> colors;
+    std::vector<std::pair<uint64_t, uint64_t>> stack;   // node and position in its list
+    std::vector<uint64_t> numbering;
+    StampedArray<long long> indexes;
+    StampedArray<long long> lowlinks;
+    StampedArray<bool> on_stack;
+    std::vector<uint64_t> component_stack;
+};
+
+// hop distances from root, by levels: a level's frontier is a bitmap read in id order
+inline void externalBFS(ExternalGraph& graph, uint64_t root, ExternalScratch& scratch) {
+    auto count = graph.getNodesCount();
+    size_t words = (count + 63) / 64;
+    auto& distances = scratch.distances;
+    auto& frontier = scratch.frontier;
+    auto& next = scratch.next;
+
+    distances.reset(count, -1);
+    frontier.assign(words, 0);
+    distances.set(root, 0);
+    frontier[root >> 6] |= 1ull << (root & 63);
+    graph.startStreaming();
+
+    for (long level = 1; ; level++) {
+        next.assign(words, 0);
+        bool found = false;
+
+        for (size_t w = 0; w < words; w++)
+            for (uint64_t bits = frontier[w]; bits; bits &= bits - 1) {
+                uint64_t node = w * 64 + __builtin_ctzll(bits);
+                graph.streamTo(node);
+                graph.forEachTarget(node, [&] (uint64_t drain) {
+                    if (distances.get(drain) == -1) {
+                        distances.set(drain, level);
+                        next[drain >> 6] |= 1ull << (drain & 63);
+                        found = true;
+                    }
+                });
+            }
+
+        if (!found)
+            return;
+        std::swap(frontier, next);
+        graph.restartStream();
+    }
+}
+
+// Graph::DFS without recursion: postorder into numbering, loops are reported as they're met
+inline void externalDFS(ExternalGraph& graph, uint64_t root, ExternalScratch& scratch) {
+    auto& colors = scratch.colors;
+    auto& stack = scratch.stack;
+    colors.reset(graph.getNodesCount(), Color::White);
+    scratch.numbering.clear();
+    graph.startRandom();
+
+    colors[root] = Color::Gray;
+    stack.assign(1, {root, graph.listBegin(root)});
+    graph.countRandomList();
+
+    while (!stack.empty()) {
+        auto& [node, position] = stack.back();
+        if (position == graph.listEnd(node)) {
+            colors[node] = Color::Black;
+            scratch.numbering.push_back(node);
+            stack.pop_back();
+            continue;
+        }
+
+        auto drain = graph.target(position++);
+        if (drain >= graph.getNodesCount())
+            continue;
+
+        if (colors[drain] == Color::White) {
+            colors[drain] = Color::Gray;
+            stack.push_back({drain, graph.listBegin(drain)});
+            graph.countRandomList();
+        } else if (colors[drain] == Color::Gray)
+            output << "Found loop " << graph.mark(node) << "->" << graph.mark(drain) << '\n';
+    }
+}
+
+// TarjanSearch without recursion, components are printed the same way
+inline void externalTarjan(ExternalGraph& graph, uint64_t root, ExternalScratch& scratch) {
+    auto& indexes = scratch.indexes;
+    auto& lowlinks = scratch.lowlinks;
+    auto& on_stack = scratch.on_stack;
+    auto& stack = scratch.stack;
+    auto& component_stack = scratch.component_stack;
+    indexes.reset(graph.getNodesCount(), -1);
+    lowlinks.reset(graph.getNodesCount(), -1);
+    on_stack.reset(graph.getNodesCount(), false);
+    component_stack.clear();
+    stack.clear();
+    graph.startRandom();
+    long long index = 0;
+
+    auto visit = [&] (uint64_t node) {
+        indexes[node] = lowlinks[node] = index++;
+        component_stack.push_back(node);
+        on_stack[node] = true;
+        stack.push_back({node, graph.listBegin(node)});
+        graph.countRandomList();
+    };
+
+    visit(root);
+    while (!stack.empty()) {
+        auto node = stack.back().first;
+        auto& position = stack.back().second;
+
+        if (position < graph.listEnd(node)) {
+            auto drain = graph.target(position++);
+            if (drain >= graph.getNodesCount())
+                continue;
+
+            if (indexes[drain] == -1)
+                visit(drain);
+            else if (on_stack[drain])
+                lowlinks[node] = std::min(lowlinks[node], lowlinks[drain]);
+            continue;
+        }
+
+        stack.pop_back();
+        if (!stack.empty())
+            lowlinks[stack.back().first] = std::min(lowlinks[stack.back().first], lowlinks[node]);
+
+        if (lowlinks[node] == indexes[node]) {
+            size_t size = 0;
+            for (auto i = component_stack.rbegin(); ; i++) {
+                size++;
+                if (*i == node)
+                    break;
+            }
+
+            for (size_t i = 0; i < size; i++) {
+                auto member = component_stack.back();
+                component_stack.pop_back();
+                on_stack[member] = false;
+                if (size > 1)
+                    output << graph.mark(member) << " ";
+            }
+            if (size > 1)
+                output << '\n';
+        }
+    }
+}
+
+// runs every command found in the line: BFS, RPO_NUMBERING, TARJAN and EXTERNAL_STATS,
+// the graph can't be changed. other words are skipped, as the command loop does
+inline void executeExternalLine(ExternalGraph& graph, std::string_view line) {
+    auto& scratch = queryScratch<ExternalScratch>();
+    Tokenizer request(line);
+
+    while (!request.empty()) {
+        auto command = request.front();
+        request.pop();
+
+        if (command == "EXTERNAL_STATS") {
+            graph.printStats();
+            continue;
+        }
+
+        if (command != "BFS" && command != "RPO_NUMBERING" && command != "TARJAN")
+            continue;
+
+        auto mark = request.front();
+        request.pop();
+        auto root = graph.find(mark);
+        if (root < 0) {
+            output << "Unknown node " << mark << '\n';
+            continue;
+        }
+
+        if (command == "BFS") {
+            externalBFS(graph, root, scratch);
+            for (uint64_t i = 0; i < graph.getNodesCount(); i++) {
+                if (i == (uint64_t)root)
+                    continue;
+
+                output << graph.mark(i) << " ";
+                if (scratch.distances.get(i) == -1)
+                    output << "inf";
+                else
+                    output << scratch.distances.get(i);
+                output << '\n';
+            }
+        } else if (command == "RPO_NUMBERING") {
+            externalDFS(graph, root, scratch);
+            for (auto i = scratch.numbering.rbegin(); i != scratch.numbering.rend(); i++)
+                output << graph.mark(*i) << " ";
+            output << '\n';
+        } else
+            externalTarjan(graph, root, scratch);
+    }
+}
+
+// command loop over stdin
+inline int runExternal(const std::string& path) {
+    ExternalGraph graph;
+    auto result = graph.open(path);
+    if (result != SnapshotResult::Done) {
+        output << (result == SnapshotResult::Failed ? "Cannot read " : "Corrupted snapshot ") << path << '\n';
+        output.flush();
+        return 1;
+    }
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line == "exit") {
+            output << "exitting...";
+            break;
+        }
+
+        executeExternalLine(graph, line);
+        output.endCommand();
+    }
+
+    output.flush();
+    return 0;
+}
+
+// writes a snapshot of nodes_count nodes named mark(i), with edges given by edges(emit): it's called
+// once per pass and calls emit(src, drain, weight) for every edge, in the same order each time.
+// edges with unknown ends are skipped. edge arrays are filled by ranges of sources taking
+// memory_bytes at most, so apart from that only per-node arrays are kept in memory
+template <class Marks, class Edges>
+SnapshotResult buildSnapshot(const std::string& path, uint64_t nodes_count, Marks&& mark, Edges&& edges,
+                             size_t memory_bytes = EXTERNAL_BUILD_BYTES) {
+    std::vector<uint64_t> offsets(nodes_count + 1, 0);
+    edges([&offsets, nodes_count] (uint64_t src, uint64_t drain, ExternalWeight) {
+        if (src < nodes_count && drain < nodes_count)
+            offsets[src + 1]++;
+    });
+    for (uint64_t i = 0; i < nodes_count; i++)
+        offsets[i + 1] += offsets[i];
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    header.version = SNAPSHOT_VERSION;
+    header.weight_size = sizeof(ExternalWeight);
+    header.nodes_count = nodes_count;
+    header.edges_count = offsets[nodes_count];
+    for (uint64_t i = 0; i < nodes_count; i++)
+        header.marks_bytes += mark(i).size();
+
+    size_t sizes[SNAPSHOT_SECTIONS] = {(nodes_count + 1) * sizeof(uint64_t), header.marks_bytes,
+                                       (nodes_count + 1) * sizeof(uint64_t), header.edges_count * sizeof(uint64_t),
+                                       header.edges_count * sizeof(ExternalWeight)};
+    size_t starts[SNAPSHOT_SECTIONS];
+    size_t size = sizeof(header);
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++) {
+        starts[i] = size;
+        size += alignSection(sizes[i]);
+    }
+
+    // written to a temporary file first, as SAVE does
+    auto temp_path = path + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return SnapshotResult::Failed;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        unlink(temp_path.c_str());
+        return SnapshotResult::Failed;
+    }
+
+    auto data = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        unlink(temp_path.c_str());
+        return SnapshotResult::Failed;
+    }
+
+    auto mark_offsets = (uint64_t*)(data + starts[0]);
+    auto marks = data + starts[1];
+    auto targets = (uint64_t*)(data + starts[3]);
+    auto weights = (ExternalWeight*)(data + starts[4]);
+
+    mark_offsets[0] = 0;
+    for (uint64_t i = 0; i < nodes_count; i++) {
+        auto node_mark = mark(i);
+        std::memcpy(marks + mark_offsets[i], node_mark.data(), node_mark.size());
+        mark_offsets[i + 1] = mark_offsets[i] + node_mark.size();
+    }
+    std::memcpy(data + starts[2], offsets.data(), sizes[2]);
+
+    // a pass per range of sources, whose part of the arrays is written back before the next one
+    auto writeBack = [] (const void* begin, size_t bytes) {
+        auto page = (uintptr_t)begin & ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+        msync((void*)page, (uintptr_t)begin + bytes - page, MS_SYNC);
+        madvise((void*)page, (uintptr_t)begin + bytes - page, MADV_DONTNEED);
+    };
+    auto edge_bytes = sizeof(uint64_t) + sizeof(ExternalWeight);
+    std::vector<uint64_t> positions;
+    for (uint64_t first = 0; first < nodes_count; ) {
+        uint64_t last = first + 1;
+        while (last < nodes_count && (offsets[last + 1] - offsets[first]) * edge_bytes <= memory_bytes)
+            last++;
+
+        positions.assign(offsets.begin() + first, offsets.begin() + last);
+        edges([&] (uint64_t src, uint64_t drain, ExternalWeight weight) {
+            if (src < first || src >= last || drain >= nodes_count)
+                return;
+
+            auto& position = positions[src - first];
+            targets[position] = drain;
+            weights[position] = weight;
+            position++;
+        });
+
+        auto count = offsets[last] - offsets[first];
+        writeBack(targets + offsets[first], count * sizeof(uint64_t));
+        writeBack(weights + offsets[first], count * sizeof(ExternalWeight));
+        first = last;
+    }
+
+    // checksums take one more sequential pass
+    madvise(data, size, MADV_SEQUENTIAL);
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++)
+        header.checksums[i] = snapshotChecksum(data + starts[i], sizes[i]);
+    header.header_checksum = snapshotChecksum(&header, offsetof(SnapshotHeader, header_checksum));
+    std::memcpy(data, &header, sizeof(header));
+
+    bool ok = msync(data, size, MS_SYNC) == 0;
+    munmap(data, size);
+    ok = fsync(fd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return SnapshotResult::Failed;
+    }
+    return SnapshotResult::Done;
+}
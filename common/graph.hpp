@@ -0,0 +1,597 @@
+#pragma once
+
+#include <iostream>
+#include <set>
+#include <stack>
+#include <queue>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <limits>
+#include <cstdint>
+
+#include "output.hpp"
+#include "scratch.hpp"
+#include "marks.hpp"
+
+#define uns unsigned
+#define EDGE_WEIGHT_T uns             // weight type for edge
+
+enum Direction {
+    No, In, Out
+};
+
+// used for colored DFS
+enum Color {
+    White, Gray, Black
+};
+
+class Node;
+
+class Edge {
+private:
+    Node* src;
+    Node* drain;
+
+    EDGE_WEIGHT_T weight = 0;
+    // index in Graph's vector edges
+    uns long id;
+public:
+
+    Edge(Node* src, Node* drain, EDGE_WEIGHT_T weight, uns long id);
+
+    // move only semantic to ensure deconstructor won't be triggered
+    // deleting instance means physical deletion from graph: nodes' disconnection evoked
+    Edge(const Edge&) = delete;
+    Edge& operator=(const Edge&) = delete;
+
+    Edge(Edge&& rhs) noexcept = default;
+    Edge& operator=(Edge&&) = default;
+
+    ~Edge();
+
+    uns long getId() {return id;}
+
+    void setId(uns long _) {id = _;}
+
+    EDGE_WEIGHT_T getWeight() const;
+
+    Node* getSrc();
+
+    Node* getDrain();
+};
+
+// adjacency is iterated in creation order: edges' ids are indices in Graph's edges,
+// and removals keep their relative order. ordering by address made traversals
+// depend on how the allocator laid out edges
+struct EdgeOrder {
+    bool operator()(Edge* lhs, Edge* rhs) const {
+        return lhs->getId() < rhs->getId();
+    }
+};
+
+typedef std::set<Edge*, EdgeOrder> EdgeSet;
+
+
+class Node {
+private:
+    EdgeSet InEdges;
+    EdgeSet OutEdges;
+    Mark mark;
+
+    // index in Graph's vector nodes
+    unsigned long id;
+public:
+    explicit Node(Mark mark, unsigned long id) : mark(mark), id(id) {}
+
+    // move only semantic to ensure deconstructor won't be triggered in some cases
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
+    Node(Node&& rhs) noexcept = default;
+    Node& operator=(Node&&) = default;
+
+    ~Node () {
+        // output << "Deleting node " << mark << '\n';
+        for (auto i : InEdges)
+            i->getSrc()->disconnectEdge(i, Direction::Out);
+
+        for (auto i : OutEdges)
+            i->getSrc()->disconnectEdge(i, Direction::In);
+    }
+
+    Mark getMark() const {
+        return mark;
+    }
+    
+    unsigned long getId() const {
+        return id;
+    }
+    
+    void setId(uns long _) {
+        id = _;
+    }
+
+    
+    void connectEdge(Edge* edge, const Direction dir) {
+        if (dir == Direction::In) {
+            if (InEdges.find(edge) == InEdges.end()) {
+                InEdges.emplace(edge);
+                return;
+            }
+
+            output << "Tried connecting " << (void*)edge << "(IN) with " << mark << ", connection exists" << '\n';
+        }
+
+        if (OutEdges.find(edge) == OutEdges.end()) {
+            OutEdges.emplace(edge);
+            return;
+        }
+
+        output << "Tried connecting " << (void*)edge << "(OUT) with " << mark << ", connection exists" << '\n';
+    }
+
+    // not used apart edge deletion
+    void disconnectEdge(Edge* edge, const Direction dir) {
+        if (dir == Direction::In) {
+            if (InEdges.find(edge) != InEdges.end()) {
+                InEdges.erase(edge);
+                return;
+            }
+
+            output << "Tried disconnecting " << (void*)edge << "(IN) from " << mark << ", connection invalid" << '\n';
+        }
+
+        if (OutEdges.find(edge) != OutEdges.end()) {
+            OutEdges.erase(edge);
+            return;
+        }
+
+        output << "Tried disconnecting " << (void*)edge << "(OUT) from " << mark << ", connection invalid" << '\n';
+    }
+
+    Edge* getOutEdge(Node* target) {
+        for (auto& i : OutEdges)
+            if (i->getDrain() == target)
+                return i;
+
+        return nullptr;
+    }
+
+    EdgeSet& getOutEdges() {
+        return OutEdges;
+    }
+
+    Edge* getInEdge(Node* target) {
+        for (auto& i : InEdges)
+            if (i->getSrc() == target)
+                return i;
+
+        return nullptr;
+    }
+
+    EdgeSet& getInEdges() {
+        return InEdges;
+    }
+
+};
+
+
+Edge::Edge(Node* src, Node* drain, EDGE_WEIGHT_T weight, u_long id) : src(src), drain(drain), weight(weight), id(id) {
+    src->connectEdge(this, Direction::Out);
+    drain->connectEdge(this, Direction::In);
+}
+
+// if being disconnected, whole instance is deleted
+Edge::~Edge () {
+    src->disconnectEdge(this, Direction::Out);
+    drain->disconnectEdge(this, Direction::In);
+
+    // output << "Disconnected " << src->getMark() << " from " << drain->getMark() << '\n';
+}
+
+EDGE_WEIGHT_T Edge::getWeight() const {
+    return weight;
+}
+
+Node* Edge::getSrc() {
+    return src;
+}
+
+Node* Edge::getDrain() {
+    return drain;
+}
+
+
+class Graph {
+private:
+    // allocation directly in instance
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<std::unique_ptr<Edge>> edges;
+
+    // bumped by every change, so results computed at the same version are the same
+    uint64_t version = 0;
+
+    // nodes by their marks, see marks.hpp
+    MarkIndex<Node> index;
+
+    Node* addNode(Mark mark) {
+        nodes.emplace_back(new Node(mark, nodes.size()));
+        index.set(mark, nodes.back().get());
+        return nodes.back().get();
+    }
+
+    void rebuildIndex() {
+        index.clear();
+        for (auto& i : nodes)
+            index.set(i->getMark(), i.get());
+    }
+
+
+
+public:
+    Node* getNode(Mark mark) {
+        return index.get(mark);
+    }
+
+    // marks which were never interned can't name a node
+    Node* getNode(std::string_view mark) {
+        Mark handle;
+        return mark_table.find(mark, handle) ? getNode(handle) : nullptr;
+    }
+
+    Node* getNode(uns long id) {
+        return nodes[id].get();
+    }
+
+    size_t getNodesCount() {
+        return nodes.size();
+    }
+
+    uint64_t getVersion() const {
+        return version;
+    }
+
+    // first disconnects linked edges, then the node
+    void removeNode(std::string_view mark) {
+        auto target = getNode(mark);
+        if (!target) {
+            output << "Unknown node " << mark << '\n';
+            return;
+        }
+
+        version++;
+        for (auto i = edges.begin(); i != edges.end(); i++)
+            if ((*i)->getSrc() == target || (*i)->getDrain() == target) {
+                edges.erase(i);
+                i--;
+            }
+
+        // update edges' id
+        for (uns i = 0; i < edges.size(); i++) {
+            edges[i]->setId(i);
+        }
+
+        auto target_id = target->getId();
+        index.erase(target->getMark());
+        nodes.erase(nodes.begin() + (signed)target_id);
+
+        // updating ids after removing
+        for (uns i = target_id; i < nodes.size(); i++) {
+            nodes[i]->setId(i);
+        }
+    }
+
+    // removes the listed nodes with their edges in one pass over nodes and edges (see applyDelta)
+    // instead of a pass per node. an unknown mark is reported as removeNode does, a node listed
+    // again is skipped
+    void removeNodes(const std::vector<std::string_view>& marks) {
+        std::vector<bool> removed;
+        for (auto i : marks) {
+            auto target = getNode(i);
+            if (!target) {
+                output << "Unknown node " << i << '\n';
+                continue;
+            }
+            if (!removed.empty() && removed[target->getId()])
+                continue;
+
+            if (removed.empty())
+                removed.resize(nodes.size(), false);
+            removed[target->getId()] = true;
+        }
+
+        if (!removed.empty())
+            applyDelta(removed, {}, {}, {});
+    }
+
+    // returns false if node already exists
+    bool emplaceNode(std::string_view mark) {
+        // avoiding repeats
+        if (getNode(mark)) {
+            output << "tried creating already existing node " << mark << '\n';
+            return false;
+        }
+
+        version++;
+        addNode(mark_table.intern(mark));
+        return true;
+    }
+
+    // no check for repeats, caller guarantees mark is new
+    void appendNode(std::string_view mark) {
+        version++;
+        addNode(mark_table.intern(mark));
+    }
+
+    // edges go first, so nodes are already disconnected when deleted
+    void clear() {
+        version++;
+        edges.clear();
+        nodes.clear();
+        index.clear();
+    }
+
+
+
+    Edge* getEdge(Node* src, Node* drain) {
+        for (auto i : src->getOutEdges())
+            if (i->getDrain() == drain)
+                return i;
+
+        return nullptr;
+    }
+
+    Edge* getEdge(uns long id) {
+        return edges[id].get();
+    }
+
+    size_t getEdgesCount() {
+        return edges.size();
+    }
+
+    // assume input is correct: connection is new, nodes exist
+    void connect(Node* src, Node* drain, EDGE_WEIGHT_T weight) {
+        version++;
+        edges.emplace_back(new Edge(src, drain, weight, edges.size()));
+    }
+
+    // returns false if there's no such edge
+    bool disconnect(Node* src, Node* drain) {
+        if (!getEdge(src, drain)) {
+            output << "Unknown edge " << src->getMark() << " " << drain->getMark() << '\n';
+            return false;
+        }
+
+        version++;
+        uns long target_id = getEdge(src, drain)->getId();
+        edges.erase(edges.begin() + (signed)target_id);
+
+        // updating ids
+        for (uns i = target_id; i < edges.size(); i++) {
+            edges[i]->setId(i);
+        }
+
+        return true;
+    }
+
+
+// Bulk build
+public:
+    // one NODE or EDGE command, marks may point into a buffer owned by caller
+    struct BuildCommand {
+        bool is_edge = false;
+        std::string_view src;   // node's mark for NODE
+        std::string_view drain;
+        EDGE_WEIGHT_T weight = 0;
+    };
+
+    // applies a run of NODE/EDGE commands at once, with storage reserved up front.
+    // result and messages are the same as if commands were applied one by one
+    void bulkBuild(const std::vector<BuildCommand>& commands) {
+        size_t new_edges = 0;
+        for (auto& i : commands)
+            new_edges += i.is_edge;
+
+        nodes.reserve(nodes.size() + commands.size() - new_edges);
+        edges.reserve(edges.size() + new_edges);
+
+        for (auto& i : commands) {
+            if (!i.is_edge) {
+                auto mark = mark_table.intern(i.src);
+                if (getNode(mark)) {
+                    output << "tried creating already existing node " << i.src << '\n';
+                    continue;
+                }
+
+                version++;
+                addNode(mark);
+                continue;
+            }
+
+            auto src = getNode(i.src);
+            auto drain = getNode(i.drain);
+
+            if (!src && !drain) {
+                output << "Unknown nodes " << i.src << " " << i.drain << '\n';
+                continue;
+            } else if (!src) {
+                output << "Unknown node " << i.src << '\n';
+                continue;
+            } else if (!drain) {
+                output << "Unknown node " << i.drain << '\n';
+                continue;
+            }
+
+            connect(src, drain, i.weight);
+        }
+    }
+
+
+// Batch apply
+public:
+    // new edge of a batch, nodes are referred to by id: ids from getNodesCount() on
+    // stand for the batch's new nodes, in their order
+    struct DeltaEdge {
+        uns long src;
+        uns long drain;
+        EDGE_WEIGHT_T weight = 0;
+    };
+
+    // applies changes collected by a mutation batch in one pass: removed edges and nodes
+    // (flags by id, empty if there are none) are dropped and survivors renumbered once,
+    // then new nodes and edges are appended. ids keep the order they'd get if changes
+    // were applied one by one, so does the graph
+    void applyDelta(const std::vector<bool>& removed_nodes, const std::vector<bool>& removed_edges,
+                    const std::vector<Mark>& new_nodes, const std::vector<DeltaEdge>& new_edges) {
+        version++;
+        std::vector<Node*> targets;
+        targets.reserve(nodes.size() + new_nodes.size());
+        for (auto& i : nodes)
+            targets.push_back(i.get());
+
+        if (!removed_nodes.empty() || !removed_edges.empty()) {
+            // ids stay untouched until everything is deleted, adjacency sets are ordered by them
+            for (auto& i : edges)
+                if ((!removed_edges.empty() && removed_edges[i->getId()]) ||
+                    (!removed_nodes.empty() && (removed_nodes[i->getSrc()->getId()] ||
+                                                removed_nodes[i->getDrain()->getId()])))
+                    i.reset();
+
+            for (uns long i = 0; i < removed_nodes.size(); i++)
+                if (removed_nodes[i]) {
+                    index.erase(nodes[i]->getMark());
+                    nodes[i].reset();
+                }
+
+            edges.erase(std::remove(edges.begin(), edges.end(), nullptr), edges.end());
+            nodes.erase(std::remove(nodes.begin(), nodes.end(), nullptr), nodes.end());
+
+            for (uns long i = 0; i < edges.size(); i++)
+                edges[i]->setId(i);
+            for (uns long i = 0; i < nodes.size(); i++)
+                nodes[i]->setId(i);
+        }
+
+        nodes.reserve(nodes.size() + new_nodes.size());
+        for (auto mark : new_nodes)
+            targets.push_back(addNode(mark));
+
+        edges.reserve(edges.size() + new_edges.size());
+        for (auto& i : new_edges)
+            connect(targets[i.src], targets[i.drain], i.weight);
+    }
+
+
+// Versions
+public:
+    // deep copy with the same marks, ids and version, so it answers every query the same way.
+    // the graph is only read, concurrent readers may traverse it meanwhile
+    std::shared_ptr<Graph> clone() {
+        auto copy = std::make_shared<Graph>();
+        copy->nodes.reserve(nodes.size());
+        copy->edges.reserve(edges.size());
+
+        for (auto& i : nodes)
+            copy->nodes.emplace_back(new Node(i->getMark(), i->getId()));
+        for (auto& i : edges)
+            copy->edges.emplace_back(new Edge(copy->nodes[i->getSrc()->getId()].get(),
+                                              copy->nodes[i->getDrain()->getId()].get(), i->getWeight(), i->getId()));
+
+        copy->rebuildIndex();
+        copy->version = version;
+        return copy;
+    }
+
+
+// Reordering
+public:
+    // order[k] is the id of the node which becomes node k. nodes, edges and adjacency are
+    // allocated anew in the new order, a node's out-edges together, so neighbours with close ids
+    // are close in memory as well. edges keep their ids, adjacency is iterated as before
+    void reorder(const std::vector<uns long>& order) {
+        std::vector<uns long> new_ids(nodes.size());
+        std::vector<std::unique_ptr<Node>> reordered;
+        reordered.reserve(nodes.size());
+        for (auto i : order) {
+            new_ids[i] = reordered.size();
+            reordered.emplace_back(new Node(nodes[i]->getMark(), reordered.size()));
+        }
+
+        // edges by their source's new id, counting sort keeps ids ascending within a node
+        std::vector<size_t> first(nodes.size() + 1, 0);
+        for (auto& i : edges)
+            first[new_ids[i->getSrc()->getId()] + 1]++;
+        for (size_t i = 0; i < nodes.size(); i++)
+            first[i + 1] += first[i];
+
+        std::vector<uns long> by_src(edges.size());
+        for (auto& i : edges)
+            by_src[first[new_ids[i->getSrc()->getId()]]++] = i->getId();
+
+        std::vector<std::unique_ptr<Edge>> rebuilt(edges.size());
+        for (auto i : by_src) {
+            auto& edge = edges[i];
+            rebuilt[i].reset(new Edge(reordered[new_ids[edge->getSrc()->getId()]].get(),
+                                      reordered[new_ids[edge->getDrain()->getId()]].get(), edge->getWeight(), i));
+        }
+
+        // old edges disconnect from old nodes, so they're dropped first
+        version++;
+        auto old_nodes = std::move(nodes);
+        nodes = std::move(reordered);
+        {
+            auto old_edges = std::move(edges);
+            edges = std::move(rebuilt);
+        }
+        rebuildIndex();
+    }
+
+
+// Topological sort
+private:
+    // kept between queries, see scratch.hpp
+    struct RPO_Scratch {
+        StampedArray<Color> colors;
+        std::vector<uns long> numbering;    // used as a stack
+    };
+
+    void DFS(uns long root_node, StampedArray<Color>& colors, std::vector<uns long>& numbering) {
+        colors[root_node] = Color::Gray;
+
+        // check successors
+        for (auto i : nodes[root_node]->getOutEdges()) {
+            if (colors[i->getDrain()->getId()] == Color::White)
+                DFS(i->getDrain()->getId(), colors, numbering);
+
+            else if (colors[i->getDrain()->getId()] == Color::Gray)
+                output << "Found loop " << nodes[root_node]->getMark() << "->" << i->getDrain()->getMark() << '\n';
+
+        }
+
+        colors[root_node] = Color::Black;
+        numbering.push_back(root_node);
+    }
+
+public:
+    void RPO_Numbering(Mark mark) {
+        auto& scratch = queryScratch<RPO_Scratch>();
+        scratch.colors.reset(nodes.size(), Color::White);
+        scratch.numbering.clear();
+
+        DFS(getNode(mark)->getId(), scratch.colors, scratch.numbering);
+
+        while (!scratch.numbering.empty()) {
+            output << nodes[scratch.numbering.back()]->getMark() << " ";
+            scratch.numbering.pop_back();
+        }
+
+        output << '\n';
+    }
+
+};
+
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tokenizer.hpp"
+#include "pool.hpp"
+
+#define INGEST_MIN_CHUNK (1 << 20)  // bytes per parsing task at least
+
+// batch ingest of a command file: the file is mmapped and split into chunks at line
+// boundaries, chunks are parsed by the thread pool into their own record buffers.
+// runs of NODE/EDGE records are then handed to Graph::bulkBuild at once,
+// every other line goes through the regular command loop in file order
+
+enum class IngestResult {
+    Done, Exit, Failed
+};
+
+template <class Graph>
+struct IngestRecord {
+    enum Kind {
+        Build, Line, Exit
+    };
+
+    Kind kind;
+    typename Graph::BuildCommand command;
+    std::string_view line;
+};
+
+// anything that isn't a well-formed NODE/EDGE command is left to the command loop,
+// so its output (including errors) stays the same as when it's read from stdin
+template <class Graph>
+IngestRecord<Graph> parseRecord(std::string_view line) {
+    IngestRecord<Graph> record{IngestRecord<Graph>::Line, {}, line};
+
+    if (line == "exit") {
+        record.kind = IngestRecord<Graph>::Exit;
+        return record;
+    }
+
+    Tokenizer request(line);
+    std::string_view tokens[5];
+    size_t count = 0;
+    for (; !request.empty() && count < 5; request.pop())
+        tokens[count++] = request.front();
+
+    if (count == 2 && tokens[0] == "NODE") {
+        record.kind = IngestRecord<Graph>::Build;
+        record.command.is_edge = false;
+        record.command.src = tokens[1];
+    }
+
+    else if (count == 4 && tokens[0] == "EDGE" && parseNumber(tokens[3], record.command.weight)) {
+        record.kind = IngestRecord<Graph>::Build;
+        record.command.is_edge = true;
+        record.command.src = tokens[1];
+        record.command.drain = tokens[2];
+    }
+
+    return record;
+}
+
+template <class Graph>
+void parseChunk(std::string_view chunk, std::vector<IngestRecord<Graph>>& records) {
+    size_t start = 0;
+
+    while (start < chunk.size()) {
+        auto end = chunk.find('\n', start);
+        if (end == std::string_view::npos)
+            end = chunk.size();
+
+        records.push_back(parseRecord<Graph>(chunk.substr(start, end - start)));
+        start = end + 1;
+    }
+}
+
+// applies records in order: runs of NODE/EDGE records go through one bulk build,
+// every other line through the command loop. Exit is returned once exit is reached
+template <class Graph, class F, class B>
+IngestResult applyRecords(Graph& graph, const std::vector<IngestRecord<Graph>>& records, F& executeLine,
+                          B& onBulkBuild) {
+    std::vector<typename Graph::BuildCommand> run;
+
+    auto flushRun = [&graph, &run, &onBulkBuild] () {
+        if (run.empty())
+            return;
+
+        if (onBulkBuild(run))
+            graph.bulkBuild(run);
+        run.clear();
+    };
+
+    for (auto& record : records) {
+        if (record.kind == IngestRecord<Graph>::Build) {
+            run.push_back(record.command);
+            continue;
+        }
+
+        flushRun();
+        if (record.kind == IngestRecord<Graph>::Exit)
+            return IngestResult::Exit;
+
+        executeLine(record.line);
+    }
+
+    flushRun();
+    return IngestResult::Done;
+}
+
+// executeLine(line) runs a line through the command loop, onBulkBuild(commands) is called
+// before the graph is changed by a bulk build and returns false if it took the commands over
+template <class Graph, class F, class B>
+IngestResult ingestFile(Graph& graph, const char* path, F&& executeLine, B&& onBulkBuild) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return IngestResult::Failed;
+
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return IngestResult::Failed;
+    }
+
+    size_t size = info.st_size;
+    if (size == 0) {
+        close(fd);
+        return IngestResult::Done;
+    }
+
+    auto data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return IngestResult::Failed;
+
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+    std::string_view file(data, size);
+
+    // chunks end right after a newline, so no line is split between tasks
+    size_t threads_count = thread_pool.getThreads();
+    threads_count = std::max((size_t)1, std::min(threads_count, size / INGEST_MIN_CHUNK));
+
+    std::vector<size_t> bounds = {0};
+    for (size_t t = 1; t < threads_count; t++) {
+        auto pos = file.find('\n', std::max(bounds.back(), t * size / threads_count));
+        if (pos == std::string_view::npos)
+            break;
+        bounds.push_back(pos + 1);
+    }
+    bounds.push_back(size);
+
+    std::vector<std::vector<IngestRecord<Graph>>> records(bounds.size() - 1);
+    thread_pool.parallelFor(0, records.size(), 1, [&file, &bounds, &records] (size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+            parseChunk<Graph>(file.substr(bounds[t], bounds[t + 1] - bounds[t]), records[t]);
+    });
+
+    // records are applied in file order
+    auto result = IngestResult::Done;
+    for (auto& chunk : records)
+        if ((result = applyRecords(graph, chunk, executeLine, onBulkBuild)) == IngestResult::Exit)
+            break;
+
+    munmap((void*)data, size);
+    return result;
+}
+
+template <class Graph, class F>
+IngestResult ingestFile(Graph& graph, const char* path, F&& executeLine) {
+    return ingestFile(graph, path, executeLine, [] (const std::vector<typename Graph::BuildCommand>&) {
+        return true;
+    });
+}
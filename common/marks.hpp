@@ -0,0 +1,308 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <charconv>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "output.hpp"
+
+// node marks are interned: a node keeps a Mark, an 8-byte handle, instead of its own string.
+// a mark which is a plain decimal number (no sign or leading zeros, at most 18 digits) is that
+// number with the top bit set: it's parsed rather than stored, hashed or compared as a string.
+// other marks are ids in the process-wide MarkTable, which keeps each string once for every
+// graph and every version of it. strings are never dropped, a removed node's mark is there
+// for the next node named so.
+// graphs find nodes by marks through a MarkIndex: arrays indexed by ids and numbers, so
+// looking a node up costs one probe of the table (none for numbers) and an array read
+
+#define MARK_NUMERIC_DIGITS 18          // below 2^63 whatever the digits
+#define MARK_BLOCK_BITS 16              // strings' addresses are kept in blocks which never move
+#define MARK_BLOCKS (1ul << 16)         // so there are at most 2^32 strings
+#define MARK_CHUNK_BYTES (1ul << 16)    // strings are copied into chunks of this size
+#define MARK_MIN_SLOTS 1024ul
+#define MARK_DENSE_SLACK 1024           // numbers below twice the count of nodes plus this are kept in an array
+
+class Mark {
+private:
+    uint64_t handle = 0;
+
+public:
+    static constexpr uint64_t NUMERIC = 1ull << 63;
+
+    Mark() = default;
+    explicit Mark(uint64_t handle) : handle(handle) {}
+
+    uint64_t getHandle() const {
+        return handle;
+    }
+
+    bool isNumeric() const {
+        return handle & NUMERIC;
+    }
+
+    // number of a numeric mark, id of a stored one
+    uint64_t getValue() const {
+        return handle & ~NUMERIC;
+    }
+
+    bool operator==(const Mark& rhs) const {
+        return handle == rhs.handle;
+    }
+
+    bool operator!=(const Mark& rhs) const {
+        return handle != rhs.handle;
+    }
+};
+
+class MarkTable {
+private:
+    mutable std::shared_mutex mutex;
+
+    // open addressing with linear probing, a slot is the upper half of the string's hash
+    // and its id + 1 (0 for an empty slot), so probes rarely compare strings
+    std::vector<uint64_t> slots;
+
+    // strings are stored as a 32-bit length followed by characters
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* chunk_next = nullptr;
+    size_t chunk_free = 0;
+    std::unique_ptr<const char*[]> blocks[MARK_BLOCKS];
+    uint64_t count = 0;
+    size_t bytes = 0;
+
+    static uint64_t hash(std::string_view text) {
+        return std::hash<std::string_view>()(text);
+    }
+
+    static std::string_view unpack(const char* stored) {
+        uint32_t length;
+        std::memcpy(&length, stored, sizeof(length));
+        return std::string_view(stored + sizeof(length), length);
+    }
+
+    const char* address(uint64_t id) const {
+        return blocks[id >> MARK_BLOCK_BITS][id & ((1ul << MARK_BLOCK_BITS) - 1)];
+    }
+
+    // slot holding the text, or the empty one where it would go
+    size_t probe(std::string_view text, uint64_t text_hash) const {
+        auto mask = slots.size() - 1;
+        for (auto i = text_hash & mask;; i = (i + 1) & mask) {
+            auto slot = slots[i];
+            if (!slot)
+                return i;
+            if ((slot >> 32) == (text_hash >> 32) && unpack(address((slot & 0xffffffff) - 1)) == text)
+                return i;
+        }
+    }
+
+    void grow() {
+        std::vector<uint64_t> old(std::max(MARK_MIN_SLOTS, slots.size() * 2), 0);
+        old.swap(slots);
+
+        auto mask = slots.size() - 1;
+        for (auto slot : old)
+            if (slot) {
+                auto i = hash(unpack(address((slot & 0xffffffff) - 1))) & mask;
+                while (slots[i])
+                    i = (i + 1) & mask;
+                slots[i] = slot;
+            }
+    }
+
+    const char* store(std::string_view text) {
+        auto size = sizeof(uint32_t) + text.size();
+        if (size > chunk_free) {
+            chunk_free = std::max(MARK_CHUNK_BYTES, size);
+            chunks.emplace_back(new char[chunk_free]);
+            chunk_next = chunks.back().get();
+        }
+
+        auto place = chunk_next;
+        uint32_t length = text.size();
+        std::memcpy(place, &length, sizeof(length));
+        std::memcpy(place + sizeof(length), text.data(), text.size());
+        chunk_next += size;
+        chunk_free -= size;
+        bytes += size;
+        return place;
+    }
+
+public:
+    static bool isNumeric(std::string_view text, uint64_t& value) {
+        if (text.empty() || text.size() > MARK_NUMERIC_DIGITS || (text[0] == '0' && text.size() > 1))
+            return false;
+
+        value = 0;
+        for (auto i : text) {
+            if (i < '0' || i > '9')
+                return false;
+            value = value * 10 + (i - '0');
+        }
+        return true;
+    }
+
+    // mark of the text, stored if it's new
+    Mark intern(std::string_view text) {
+        Mark mark;
+        if (find(text, mark))
+            return mark;
+
+        auto text_hash = hash(text);
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if ((count + 1) * 2 > slots.size())
+            grow();
+
+        auto i = probe(text, text_hash);
+        if (slots[i])
+            return Mark((slots[i] & 0xffffffff) - 1);
+
+        auto& block = blocks[count >> MARK_BLOCK_BITS];
+        if (!block)
+            block.reset(new const char*[1ul << MARK_BLOCK_BITS]);
+
+        block[count & ((1ul << MARK_BLOCK_BITS) - 1)] = store(text);
+        slots[i] = (text_hash & 0xffffffff00000000) | (count + 1);
+        return Mark(count++);
+    }
+
+    // false if no node was ever named so
+    bool find(std::string_view text, Mark& mark) const {
+        uint64_t value;
+        if (isNumeric(text, value)) {
+            mark = Mark(Mark::NUMERIC | value);
+            return true;
+        }
+
+        auto text_hash = hash(text);
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (slots.empty())
+            return false;
+
+        auto slot = slots[probe(text, text_hash)];
+        if (!slot)
+            return false;
+
+        mark = Mark((slot & 0xffffffff) - 1);
+        return true;
+    }
+
+    // text of a stored mark. it's read without locking: whoever holds the mark
+    // got it after the string was stored
+    std::string_view text(Mark mark) const {
+        return unpack(address(mark.getValue()));
+    }
+
+    // strings stored so far and bytes they take
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return count;
+    }
+
+    size_t storedBytes() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto blocks_count = (count + (1ul << MARK_BLOCK_BITS) - 1) >> MARK_BLOCK_BITS;
+        return bytes + slots.size() * sizeof(uint64_t) + (blocks_count << MARK_BLOCK_BITS) * sizeof(const char*);
+    }
+};
+
+// shared by everything in the process
+inline MarkTable mark_table;
+
+// mark's characters, numeric marks are formatted into the object itself
+class MarkText {
+private:
+    char digits[MARK_NUMERIC_DIGITS];
+    size_t length = 0;
+    std::string_view stored;
+
+public:
+    explicit MarkText(Mark mark) {
+        if (mark.isNumeric())
+            length = std::to_chars(digits, digits + MARK_NUMERIC_DIGITS, mark.getValue()).ptr - digits;
+        else
+            stored = mark_table.text(mark);
+    }
+
+    std::string_view view() const {
+        return length ? std::string_view(digits, length) : stored;
+    }
+};
+
+inline Output& operator<<(Output& out, Mark mark) {
+    if (mark.isNumeric())
+        return out << mark.getValue();
+    return out << mark_table.text(mark);
+}
+
+// a graph's nodes by their marks. stored marks' ids and numbers up to about twice the
+// count of nodes index arrays, sparse numbers go to a hash map
+template <class T>
+class MarkIndex {
+private:
+    std::vector<T*> named;
+    std::vector<T*> numbered;
+    std::unordered_map<uint64_t, T*> sparse;
+    size_t count = 0;
+
+public:
+    T* get(Mark mark) const {
+        auto value = mark.getValue();
+        if (!mark.isNumeric())
+            return value < named.size() ? named[value] : nullptr;
+
+        if (value < numbered.size() && numbered[value])
+            return numbered[value];
+        if (sparse.empty())
+            return nullptr;
+
+        auto node = sparse.find(value);
+        return node == sparse.end() ? nullptr : node->second;
+    }
+
+    // the mark must be new to the index
+    void set(Mark mark, T* node) {
+        auto value = mark.getValue();
+        count++;
+        if (!mark.isNumeric()) {
+            if (value >= named.size())
+                named.resize(value + 1, nullptr);
+            named[value] = node;
+            return;
+        }
+
+        if (value >= numbered.size() && value < 2 * count + MARK_DENSE_SLACK)
+            numbered.resize(value + 1, nullptr);
+
+        if (value < numbered.size())
+            numbered[value] = node;
+        else
+            sparse.emplace(value, node);
+    }
+
+    void erase(Mark mark) {
+        auto value = mark.getValue();
+        count--;
+        if (!mark.isNumeric())
+            named[value] = nullptr;
+        else if (value < numbered.size() && numbered[value])
+            numbered[value] = nullptr;
+        else
+            sparse.erase(value);
+    }
+
+    void clear() {
+        std::vector<T*>().swap(named);
+        std::vector<T*>().swap(numbered);
+        sparse.clear();
+        count = 0;
+    }
+};
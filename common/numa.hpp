@@ -0,0 +1,212 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// NUMA placement: a page lands on the node of the thread which touches it first, so arrays
+// written by the thread which allocated them are remote for the pool's threads on other nodes.
+// on machines with more than one node the pool pins its workers round robin over nodes and
+// gives parallelFor's ranges to workers in fixed blocks (see pool.hpp), so the same worker
+// gets the same part of an array every time. a NumaArray is allocated untouched and filled
+// through such ranges (Local), spread over nodes page by page (Interleaved), or written by the
+// allocating thread (Caller, what a std::vector does).
+// nodes come from sysfs; with a single node (or no sysfs) nothing is pinned or bound,
+// and the pool works as it always did
+
+#define NUMA_MAX_NODES 64
+#define NUMA_MPOL_INTERLEAVE 3      // linux/mempolicy.h
+
+enum class NumaPlacement {
+    Caller, Local, Interleaved
+};
+
+class NumaTopology {
+private:
+    std::vector<int> ids;                   // sysfs numbers of nodes with cpus we may run on
+    std::vector<std::vector<int>> cpus;
+
+    // "0-3,8,10-11"
+    static std::vector<int> parseList(const std::string& list) {
+        std::vector<int> result;
+        size_t position = 0;
+        while (position < list.size()) {
+            auto end = list.find(',', position);
+            if (end == std::string::npos)
+                end = list.size();
+
+            auto range = list.substr(position, end - position);
+            auto dash = range.find('-');
+            if (!range.empty()) {
+                int first = std::stoi(range.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int i = first; i <= last; i++)
+                    result.push_back(i);
+            }
+            position = end + 1;
+        }
+        return result;
+    }
+
+public:
+    NumaTopology() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+
+        for (int node = 0; node < NUMA_MAX_NODES; node++) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            if (!file || !std::getline(file, list))
+                continue;
+
+            std::vector<int> node_cpus;
+            for (auto cpu : parseList(list))
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                    node_cpus.push_back(cpu);
+
+            if (!node_cpus.empty()) {
+                ids.push_back(node);
+                cpus.push_back(std::move(node_cpus));
+            }
+        }
+
+        if (ids.empty()) {
+            ids.push_back(0);
+            cpus.emplace_back();
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &allowed))
+                    cpus.back().push_back(cpu);
+        }
+    }
+
+    size_t nodesCount() const {
+        return ids.size();
+    }
+
+    // nodes take turns, so workers spread over all of them before a node gets a second one
+    size_t nodeOf(size_t worker) const {
+        return worker % ids.size();
+    }
+
+    int cpuOf(size_t worker) const {
+        auto& node_cpus = cpus[nodeOf(worker)];
+        return node_cpus.empty() ? -1 : node_cpus[worker / ids.size() % node_cpus.size()];
+    }
+
+    // mask of every node for mbind
+    unsigned long nodeMask() const {
+        unsigned long mask = 0;
+        for (auto i : ids)
+            mask |= 1ul << i;
+        return mask;
+    }
+};
+
+// shared by everything in the process
+inline NumaTopology numa_topology;
+
+inline void pinCurrentThread(int cpu) {
+    if (cpu < 0)
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// array of zero-initialized elements (types for which zero bytes are a valid value)
+// whose pages are placed as asked, see above. Local leaves them to the first writer
+template <class T>
+class NumaArray {
+private:
+    T* values = nullptr;
+    size_t count = 0;
+    size_t bytes = 0;
+
+    void release() {
+        if (values)
+            munmap(values, bytes);
+        values = nullptr;
+        count = bytes = 0;
+    }
+
+public:
+    NumaArray() = default;
+
+    NumaArray(const NumaArray&) = delete;
+    NumaArray& operator=(const NumaArray&) = delete;
+
+    NumaArray(NumaArray&& other) noexcept {
+        swap(other);
+    }
+
+    NumaArray& operator=(NumaArray&& other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~NumaArray() {
+        release();
+    }
+
+    void swap(NumaArray& other) noexcept {
+        std::swap(values, other.values);
+        std::swap(count, other.count);
+        std::swap(bytes, other.bytes);
+    }
+
+    // previous contents are dropped
+    void allocate(size_t _count, NumaPlacement placement) {
+        release();
+        if (!_count)
+            return;
+
+        auto page = (size_t)sysconf(_SC_PAGESIZE);
+        auto size = (_count * sizeof(T) + page - 1) / page * page;
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw std::bad_alloc();
+
+        values = (T*)memory;
+        count = _count;
+        bytes = size;
+
+        if (placement == NumaPlacement::Interleaved && numa_topology.nodesCount() > 1) {
+            auto mask = numa_topology.nodeMask();
+            syscall(SYS_mbind, values, bytes, NUMA_MPOL_INTERLEAVE, &mask, sizeof(mask) * 8, 0);
+        }
+        if (placement != NumaPlacement::Local)
+            std::memset((void*)values, 0, bytes);
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    T* data() {
+        return values;
+    }
+
+    const T* data() const {
+        return values;
+    }
+
+    T& operator[](size_t i) {
+        return values[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return values[i];
+    }
+};
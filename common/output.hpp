@@ -0,0 +1,168 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <cstdint>
+#include <type_traits>
+#include <unistd.h>
+
+#include "ring.hpp"
+
+#define OUTPUT_BLOCK (1 << 16)  // bytes collected before a write is issued
+
+// buffered stdout sink shared by the command loop and algorithms.
+// results are formatted straight into a block (integers via to_chars) and written
+// once the block fills up, at exit or on flush(); std::endl would issue a write per line.
+// interactive mode flushes after every command instead.
+// every thread has its own sink, server's workers capture it into their client's response.
+// stdin pipeline hands filled blocks to its writer thread instead of writing them
+class Output {
+private:
+    char buffer[OUTPUT_BLOCK];
+    size_t size = 0;
+    bool interactive = false;
+    bool muted = false;
+    std::string* capture = nullptr;
+    SpscRing<std::string>* stage = nullptr;
+    std::string* record = nullptr;
+    size_t record_start = 0;    // recorded part of the buffer starts here
+
+    void write(const char* data, size_t count) {
+        if (capture) {
+            capture->append(data, count);
+            return;
+        }
+
+        if (stage) {
+            if (count)
+                stage->push(std::string(data, count));
+            return;
+        }
+
+        size_t written = 0;
+        while (written < count) {
+            auto result = ::write(STDOUT_FILENO, data + written, count - written);
+            if (result <= 0)
+                break;
+            written += result;
+        }
+    }
+
+    void reserve(size_t count) {
+        if (size + count > OUTPUT_BLOCK)
+            flush();
+    }
+
+public:
+    Output() = default;
+
+    Output(const Output&) = delete;
+    Output& operator=(const Output&) = delete;
+
+    ~Output() {
+        flush();
+    }
+
+    void setInteractive(bool _) {
+        interactive = _;
+    }
+
+    bool isInteractive() const {
+        return interactive;
+    }
+
+    // muted output is dropped instead of written
+    void setMuted(bool _) {
+        muted = _;
+    }
+
+    // flushed output is appended to target instead of stdout, nullptr switches back
+    void captureInto(std::string* target) {
+        flush();
+        capture = target;
+    }
+
+    // flushed blocks are pushed into ring instead of stdout, nullptr switches back
+    void handOffTo(SpscRing<std::string>* ring) {
+        flush();
+        stage = ring;
+    }
+
+    // output goes on as usual and is copied into target as well, until stopRecording().
+    // the copy is taken from the buffer, so recording doesn't cause extra writes
+    void recordInto(std::string* target) {
+        record = target;
+        record_start = size;
+    }
+
+    void stopRecording() {
+        if (record)
+            record->append(buffer + record_start, size - record_start);
+        record = nullptr;
+    }
+
+    void flush() {
+        if (record) {
+            record->append(buffer + record_start, size - record_start);
+            record_start = 0;
+        }
+
+        if (!muted)
+            write(buffer, size);
+
+        size = 0;
+    }
+
+    // called by command loop once a command is processed
+    void endCommand() {
+        if (interactive)
+            flush();
+    }
+
+    Output& operator<<(std::string_view text) {
+        // text larger than a block goes around the buffer
+        if (text.size() > OUTPUT_BLOCK) {
+            flush();
+            if (record)
+                record->append(text);
+            if (!muted)
+                write(text.data(), text.size());
+            return *this;
+        }
+
+        reserve(text.size());
+        text.copy(buffer + size, text.size());
+        size += text.size();
+        return *this;
+    }
+
+    Output& operator<<(const char* text) {
+        return *this << std::string_view(text);
+    }
+
+    Output& operator<<(char symbol) {
+        reserve(1);
+        buffer[size++] = symbol;
+        return *this;
+    }
+
+    template <class T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value &&
+                                               !std::is_same<T, bool>::value, int>::type = 0>
+    Output& operator<<(T value) {
+        reserve(24);
+        size = std::to_chars(buffer + size, buffer + OUTPUT_BLOCK, value).ptr - buffer;
+        return *this;
+    }
+
+    // pointers are printed in hex, as std::ostream does
+    Output& operator<<(const void* pointer) {
+        reserve(24);
+        buffer[size++] = '0';
+        buffer[size++] = 'x';
+        size = std::to_chars(buffer + size, buffer + OUTPUT_BLOCK, (uintptr_t)pointer, 16).ptr - buffer;
+        return *this;
+    }
+};
+
+inline thread_local Output output;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+
+#include "ring.hpp"
+#include "ingest.hpp"
+#include "output.hpp"
+
+// stdin is processed by three stages connected with SPSC rings:
+//   reader    reads blocks, cuts them at line boundaries and decodes lines into records
+//   executor  (calling thread) applies records in order, the same way --input does
+//   writer    writes output blocks the executor filled
+// so reading, parsing and writing overlap with execution. there's one executor,
+// so output keeps the order and messages of the sequential loop
+
+#define PIPELINE_READ_BLOCK (1 << 16)
+#define PIPELINE_BATCHES 64         // decoded blocks in flight
+#define PIPELINE_OUTPUT_BLOCKS 64
+#define PIPELINE_POLL_MS 100        // how often a waiting reader checks the executor is still there
+
+template <class Graph>
+struct PipelineBatch {
+    std::string text;   // whole lines, records point into it
+    std::vector<IngestRecord<Graph>> records;
+};
+
+template <class Graph>
+void readStage(int fd, SpscRing<std::unique_ptr<PipelineBatch<Graph>>>& batches) {
+    std::string carry;  // line which isn't complete yet
+
+    while (!batches.isClosed()) {
+        // executor may stop (on exit) while the input is still open
+        pollfd wait{fd, POLLIN, 0};
+        if (poll(&wait, 1, PIPELINE_POLL_MS) == 0)
+            continue;
+
+        auto batch = std::make_unique<PipelineBatch<Graph>>();
+        auto& text = batch->text;
+        text.swap(carry);
+
+        auto start = text.size();
+        text.resize(start + PIPELINE_READ_BLOCK);
+        auto count = read(fd, text.data() + start, PIPELINE_READ_BLOCK);
+        if (count < 0 && errno == EINTR) {
+            text.resize(start);
+            carry.swap(text);
+            continue;
+        }
+
+        // last line might come without a newline
+        if (count <= 0) {
+            text.resize(start);
+            if (!text.empty()) {
+                parseChunk<Graph>(text, batch->records);
+                batches.push(std::move(batch));
+            }
+            break;
+        }
+
+        text.resize(start + count);
+        auto end = text.rfind('\n');
+        if (end == std::string::npos) {
+            carry.swap(text);
+            continue;
+        }
+
+        carry.assign(text, end + 1);
+        text.resize(end + 1);
+        parseChunk<Graph>(text, batch->records);
+
+        if (!batches.push(std::move(batch)))
+            break;
+    }
+
+    batches.close();
+}
+
+inline void writeStage(SpscRing<std::string>& blocks) {
+    std::string block;
+
+    while (blocks.pop(block)) {
+        size_t written = 0;
+        while (written < block.size()) {
+            auto result = ::write(STDOUT_FILENO, block.data() + written, block.size() - written);
+            if (result <= 0)
+                break;
+            written += result;
+        }
+    }
+}
+
+// executeLine and onBulkBuild are the same as for ingestFile
+template <class Graph, class F, class B>
+IngestResult ingestStream(Graph& graph, int fd, F&& executeLine, B&& onBulkBuild) {
+    SpscRing<std::unique_ptr<PipelineBatch<Graph>>> batches(PIPELINE_BATCHES);
+    SpscRing<std::string> blocks(PIPELINE_OUTPUT_BLOCKS);
+
+    std::thread writer(writeStage, std::ref(blocks));
+    output.handOffTo(&blocks);
+    std::thread reader(readStage<Graph>, fd, std::ref(batches));
+
+    auto result = IngestResult::Done;
+    std::unique_ptr<PipelineBatch<Graph>> batch;
+    while (batches.pop(batch))
+        if ((result = applyRecords(graph, batch->records, executeLine, onBulkBuild)) == IngestResult::Exit)
+            break;
+
+    batches.close();
+    reader.join();
+
+    output.handOffTo(nullptr);
+    blocks.close();
+    writer.join();
+
+    return result;
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+#include "numa.hpp"
+
+// work-stealing scheduler shared by the parallel parts of algorithms and ingest.
+// every worker has its own deque: it pushes and pops its tasks at the back, idle workers
+// steal from the front of others'. tasks forked by threads outside the pool (main thread,
+// server's workers) go to a shared queue. a thread waiting for its tasks executes
+// pending ones meanwhile, so forks may nest and waiting never blocks a worker.
+// threads are started on first use, --threads sets their count.
+// on NUMA machines workers are pinned, steal from their own node first, and parallelFor hands
+// its ranges out in fixed blocks (see numa.hpp)
+
+#define POOL_SPLITS 4   // parallelFor's ranges per thread, so stolen work balances uneven ranges
+
+class ThreadPool {
+private:
+    typedef std::function<void()> Task;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t threads_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::unique_ptr<Queue>> queues;     // one per worker, the last is the shared one
+    std::vector<std::thread> workers;
+    bool started = false;
+    std::mutex start_mutex;
+    bool numa_aware = numa_topology.nodesCount() > 1;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued{0};      // tasks sitting in queues
+    bool stopping = false;
+
+    // index of the queue thread pushes into, workers have their own
+    static size_t& ownQueue() {
+        static thread_local size_t index = ~0ul;
+        return index;
+    }
+
+    void push(Task task) {
+        push(std::move(task), std::min(ownQueue(), queues.size() - 1));
+    }
+
+    void push(Task task, size_t index) {
+        {
+            std::unique_lock<std::mutex> lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+
+        queued++;
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_one();
+    }
+
+    // own tasks newest first, then the oldest of somebody else's.
+    // threads outside the pool own the shared queue
+    bool pop(Task& task) {
+        auto own = std::min(ownQueue(), queues.size() - 1);
+        {
+            std::unique_lock<std::mutex> lock(queues[own]->mutex);
+            if (!queues[own]->tasks.empty()) {
+                task = std::move(queues[own]->tasks.back());
+                queues[own]->tasks.pop_back();
+                queued--;
+                return true;
+            }
+        }
+
+        // NUMA-aware workers try their node's queues in the first round
+        auto start = own + 1;
+        bool worker = own + 1 < queues.size();
+        for (size_t round = numa_aware && worker ? 0 : 1; round < 2; round++)
+            for (size_t i = 0; i < queues.size(); i++) {
+                auto victim_index = (start + i) % queues.size();
+                if (round == 0 && (victim_index + 1 == queues.size() ||
+                                   numa_topology.nodeOf(victim_index) != numa_topology.nodeOf(own)))
+                    continue;
+
+                auto& victim = *queues[victim_index];
+                std::unique_lock<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    queued--;
+                    return true;
+                }
+            }
+
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        ownQueue() = index;
+        if (numa_aware)
+            pinCurrentThread(numa_topology.cpuOf(index));
+        Task task;
+
+        while (true) {
+            if (pop(task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] () { return stopping || queued > 0; });
+            if (stopping)
+                return;
+        }
+    }
+
+    // caller itself runs tasks while it waits, so it's one of threads_count
+    void start() {
+        std::unique_lock<std::mutex> lock(start_mutex);
+        if (started)
+            return;
+
+        for (size_t i = 0; i < threads_count; i++)
+            queues.push_back(std::make_unique<Queue>());
+        for (size_t i = 0; i + 1 < threads_count; i++)
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        started = true;
+    }
+
+    void stop() {
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& i : workers)
+            i.join();
+        workers.clear();
+        queues.clear();
+        stopping = false;
+        started = false;
+    }
+
+public:
+    ThreadPool() = default;
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        stop();
+    }
+
+    // threads taking part in parallel work, the calling one included.
+    // must be called while nothing runs in the pool
+    void setThreads(size_t count) {
+        stop();
+        threads_count = std::max((size_t)1, count);
+    }
+
+    size_t getThreads() const {
+        return threads_count;
+    }
+
+    // on by default with more than one NUMA node, must be called while nothing runs in the pool
+    void setNumaAware(bool _) {
+        stop();
+        numa_aware = _;
+    }
+
+    bool isNumaAware() const {
+        return numa_aware;
+    }
+
+    // forked tasks are waited for by wait(), which also runs pending tasks of the pool
+    class TaskGroup {
+    private:
+        ThreadPool& pool;
+        std::atomic<size_t> pending{0};
+
+    public:
+        explicit TaskGroup(ThreadPool& pool) : pool(pool) {
+            pool.start();
+        }
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        ~TaskGroup() {
+            wait();
+        }
+
+        // f must stay alive until wait() returns
+        template <class F>
+        void fork(F&& f) {
+            forkTo(pool.ownQueue(), std::forward<F>(f));
+        }
+
+        // into the given queue instead of the calling thread's
+        template <class F>
+        void forkTo(size_t queue, F&& f) {
+            if (pool.threads_count == 1) {
+                f();
+                return;
+            }
+
+            pending++;
+            pool.push([this, f = std::forward<F>(f)] () mutable {
+                f();
+                pending--;
+            }, std::min(queue, pool.queues.size() - 1));
+        }
+
+        void wait() {
+            Task task;
+            while (pending > 0) {
+                if (pool.pop(task)) {
+                    task();
+                    task = nullptr;
+                } else
+                    std::this_thread::yield();
+            }
+        }
+    };
+
+    // f(begin, end) over subranges of [begin, end) no shorter than grain, in parallel
+    template <class F>
+    void parallelFor(size_t begin, size_t end, size_t grain, F&& f) {
+        if (end <= begin)
+            return;
+
+        size_t count = end - begin;
+        size_t chunk = std::max(std::max((size_t)1, grain), (count + threads_count * POOL_SPLITS - 1) /
+                                                            (threads_count * POOL_SPLITS));
+        if (threads_count == 1 || chunk >= count) {
+            f(begin, end);
+            return;
+        }
+
+        TaskGroup group(*this);
+
+        // block of ranges per queue, the caller's is the last one: with the same arguments
+        // every range goes to the same worker, which first-touched its part of the arrays
+        if (numa_aware) {
+            size_t ranges = (count + chunk - 1) / chunk;
+            for (size_t k = 0; k < ranges; k++) {
+                auto i = begin + k * chunk;
+                group.forkTo(k * queues.size() / ranges, [&f, i, chunk, end] () {
+                    f(i, std::min(end, i + chunk));
+                });
+            }
+
+            group.wait();
+            return;
+        }
+
+        for (size_t i = begin + chunk; i < end; i += chunk)
+            group.fork([&f, i, chunk, end] () {
+                f(i, std::min(end, i + chunk));
+            });
+
+        f(begin, begin + chunk);
+        group.wait();
+    }
+};
+
+// shared by everything in the process
+inline ThreadPool thread_pool;
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+
+#include "graph.hpp"
+#include "tokenizer.hpp"
+
+// algorithm commands known to the command loop (see engine.hpp). every task registers
+// its algorithms, the engine binary registers all of them over the same graph.
+// a command takes arity node marks, the loop checks they exist before run is called.
+// commands with other arguments (names, weights, nested commands) read them from the line themselves
+
+#define ALGORITHM_MAX_ARITY 4
+
+struct AlgorithmCommand {
+    std::string_view name;  // may be several words, e.g. "MAX FLOW"
+    size_t words;
+    size_t arity;
+    bool cached;            // result is reused while the graph stays the same (see cache.hpp)
+    std::function<void(Graph&, Node* const* nodes)> run;
+    // set instead of run for commands parsing their own arguments: pops them from request
+    // and runs the command, graph is nullptr when the line is only walked (see isReadOnly).
+    // such commands don't change the graph and aren't cached
+    std::function<void(Graph*, Tokenizer& request)> parse;
+};
+
+class AlgorithmRegistry {
+private:
+    // by the first word of the name
+    std::unordered_map<std::string_view, AlgorithmCommand> commands;
+
+public:
+    void add(std::string_view name, size_t arity, bool cached, std::function<void(Graph&, Node* const*)> run) {
+        size_t words = 1;
+        for (auto i : name)
+            words += i == ' ';
+
+        commands[name.substr(0, name.find(' '))] = {name, words, arity, cached, std::move(run), nullptr};
+    }
+
+    // single-word command parsing its own arguments
+    void addParsed(std::string_view name, std::function<void(Graph*, Tokenizer&)> parse) {
+        commands[name] = {name, 1, 0, false, nullptr, std::move(parse)};
+    }
+
+    // nullptr if the word doesn't start a command
+    const AlgorithmCommand* find(std::string_view word) const {
+        auto command = commands.find(word);
+        return command == commands.end() ? nullptr : &command->second;
+    }
+};
+
+// reverse postorder numbering is a part of Graph, every task has it
+inline void registerRPO(AlgorithmRegistry& registry) {
+    registry.add("RPO_NUMBERING", 1, true, [] (Graph& graph, Node* const* nodes) {
+        graph.RPO_Numbering(nodes[0]->getMark());
+    });
+}
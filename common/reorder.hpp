@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <algorithm>
+
+#include "graph.hpp"
+
+// node orders for REORDER. per-node arrays of algorithms are indexed by id and Graph::reorder
+// lays nodes out in id order, so ids close for neighbours keep a traversal's accesses in cache.
+// ids follow insertion order otherwise, which for imported data is as good as random.
+// every order is over the undirected view of the graph, order[k] is the node which becomes k:
+//  RCM     reverse Cuthill-McKee: BFS from a low-degree node of every component,
+//          neighbours in increasing degree, reversed. keeps the adjacency "band" narrow
+//  BFS     BFS in id order, neighbours as they're iterated. cheaper, most of RCM's locality
+//  DEGREE  decreasing degree: hubs, touched by most traversals, share cache lines
+
+inline size_t undirectedDegree(Graph& graph, uns long node) {
+    return graph.getNode(node)->getOutEdges().size() + graph.getNode(node)->getInEdges().size();
+}
+
+// breadth-first numbering of every component, roots are taken in the given order.
+// by_degree sorts every node's unvisited neighbours by increasing degree
+inline std::vector<uns long> breadthFirstOrder(Graph& graph, const std::vector<uns long>& roots, bool by_degree) {
+    auto count = graph.getNodesCount();
+    std::vector<uns long> order;
+    order.reserve(count);
+    std::vector<uint8_t> visited(count, false);
+    std::vector<uns long> found;
+
+    for (auto root : roots) {
+        if (visited[root])
+            continue;
+
+        visited[root] = true;
+        order.push_back(root);
+        // order itself is the queue
+        for (size_t head = order.size() - 1; head < order.size(); head++) {
+            auto node = graph.getNode(order[head]);
+            found.clear();
+
+            for (auto i : node->getOutEdges())
+                if (!visited[i->getDrain()->getId()]) {
+                    visited[i->getDrain()->getId()] = true;
+                    found.push_back(i->getDrain()->getId());
+                }
+            for (auto i : node->getInEdges())
+                if (!visited[i->getSrc()->getId()]) {
+                    visited[i->getSrc()->getId()] = true;
+                    found.push_back(i->getSrc()->getId());
+                }
+
+            if (by_degree)
+                std::stable_sort(found.begin(), found.end(), [&graph] (uns long lhs, uns long rhs) {
+                    return undirectedDegree(graph, lhs) < undirectedDegree(graph, rhs);
+                });
+            order.insert(order.end(), found.begin(), found.end());
+        }
+    }
+
+    return order;
+}
+
+// nodes sorted by degree, ties keep id order
+inline std::vector<uns long> degreeOrder(Graph& graph, bool decreasing) {
+    std::vector<uns long> order(graph.getNodesCount());
+    std::vector<size_t> degrees(order.size());
+    for (uns long i = 0; i < order.size(); i++) {
+        order[i] = i;
+        degrees[i] = undirectedDegree(graph, i);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&degrees, decreasing] (uns long lhs, uns long rhs) {
+        return decreasing ? degrees[lhs] > degrees[rhs] : degrees[lhs] < degrees[rhs];
+    });
+    return order;
+}
+
+// false if there's no such strategy
+inline bool nodeOrder(Graph& graph, std::string_view strategy, std::vector<uns long>& order) {
+    if (strategy == "RCM") {
+        order = breadthFirstOrder(graph, degreeOrder(graph, false), true);
+        std::reverse(order.begin(), order.end());
+    } else if (strategy == "BFS") {
+        std::vector<uns long> roots(graph.getNodesCount());
+        for (uns long i = 0; i < roots.size(); i++)
+            roots[i] = i;
+        order = breadthFirstOrder(graph, roots, false);
+    } else if (strategy == "DEGREE")
+        order = degreeOrder(graph, true);
+    else
+        return false;
+
+    return true;
+}
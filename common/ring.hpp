@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// bounded lock-free queue between exactly one producer and one consumer thread.
+// head and tail live on their own cache lines, each is written by one side only.
+// either side may close the ring: consumer drains what's left, producer's pushes fail
+
+#define RING_SPINS 64           // yields before a waiting side starts sleeping
+#define RING_SLEEP_US 50
+
+template <class T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> head{0};   // next slot to pop, written by consumer
+    alignas(64) std::atomic<size_t> tail{0};   // next slot to push, written by producer
+    alignas(64) std::atomic<bool> closed{false};
+
+    static void backoff(size_t attempt) {
+        if (attempt < RING_SPINS)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(RING_SLEEP_US));
+    }
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    bool tryPush(T& value) {
+        auto curr = tail.load(std::memory_order_relaxed);
+        if (curr - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+
+        slots[curr & mask] = std::move(value);
+        tail.store(curr + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        auto curr = head.load(std::memory_order_relaxed);
+        if (curr == tail.load(std::memory_order_acquire))
+            return false;
+
+        value = std::move(slots[curr & mask]);
+        head.store(curr + 1, std::memory_order_release);
+        return true;
+    }
+
+    // waits while the ring is full, false if it was closed meanwhile
+    bool push(T value) {
+        for (size_t attempt = 0; !tryPush(value); attempt++) {
+            if (isClosed())
+                return false;
+            backoff(attempt);
+        }
+
+        return true;
+    }
+
+    // waits while the ring is empty, false once it's closed and drained
+    bool pop(T& value) {
+        for (size_t attempt = 0; !tryPop(value); attempt++) {
+            if (isClosed())
+                return tryPop(value);
+            backoff(attempt);
+        }
+
+        return true;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    bool isClosed() const {
+        return closed.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+// per-query working memory which outlives the query: algorithms keep their arrays
+// in a scratch struct of their own, so back-to-back queries reuse the same buffers
+// instead of allocating them. every thread running queries (command loop, server's
+// workers) has its own arena, pool's tasks work with the arrays of the query they belong to
+
+template <class Buffers>
+Buffers& queryScratch() {
+    static thread_local Buffers buffers;
+    return buffers;
+}
+
+// array which is reset in O(1): every element carries the epoch it was written in,
+// elements of an older epoch read as the initial value. only growing the array
+// (and epoch wrap-around, once in 2^32 resets) touches every element.
+// distinct elements may be written by different threads at once
+// (so bools are kept in bytes, std::vector<bool> would share words between them)
+template <class T>
+class StampedArray {
+private:
+    typedef std::conditional_t<std::is_same_v<T, bool>, uint8_t, T> Stored;
+
+    std::vector<Stored> values;
+    std::vector<uint32_t> stamps;
+    uint32_t epoch = 0;
+    T initial{};
+
+public:
+    // elements [0, count) read as _initial afterwards
+    void reset(size_t count, const T& _initial) {
+        initial = _initial;
+
+        if (stamps.size() < count) {
+            values.resize(count);
+            stamps.resize(count, 0);
+        }
+
+        if (++epoch == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    T get(size_t i) const {
+        return stamps[i] == epoch ? values[i] : initial;
+    }
+
+    void set(size_t i, const T& value) {
+        values[i] = value;
+        stamps[i] = epoch;
+    }
+
+    // element is stamped on access, so reading it this way counts as a write
+    Stored& operator[](size_t i) {
+        if (stamps[i] != epoch) {
+            values[i] = initial;
+            stamps[i] = epoch;
+        }
+        return values[i];
+    }
+};
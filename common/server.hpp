@@ -0,0 +1,367 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "output.hpp"
+
+// daemon mode: one graph stays resident and clients speak the usual text protocol
+// over a unix domain socket (socat - UNIX-CONNECT:<path> works as a client).
+// I/O is driven by epoll on the main thread, lines are executed by worker threads
+// (executeLine decides how they share the graph, see versions.hpp).
+// lines of one client are executed one at a time, so its responses keep their order.
+// a client which sends faster than its lines are executed, or doesn't read its responses,
+// isn't read from until it catches up, so what it has queued stays bounded
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_READ_BLOCK (1 << 16)
+#define SERVER_MAX_LINES 1024             // queued lines of a client
+#define SERVER_MAX_BUFFERED (1ul << 20)   // bytes of its queued lines, and of its responses
+#define SERVER_TOO_LONG "\n"               // queued in place of a longer line, no line holds a newline
+
+inline std::atomic<bool> server_stopping(false);
+
+inline void stopServer(int) {
+    server_stopping = true;
+}
+
+class Server {
+private:
+    struct Client {
+        int fd;
+        std::string in;
+        std::string out;
+        std::deque<std::string> lines;
+        size_t lines_bytes = 0;
+        bool busy = false;      // a line of this client is being executed
+        bool closing = false;   // client sent EOF or "exit"
+        bool skipping = false;  // rest of a line longer than SERVER_MAX_BUFFERED is dropped
+        uint32_t events = 0;    // registered in epoll, 0 when it isn't there
+    };
+
+    struct Task {
+        uint64_t client;
+        std::string line;
+        std::string result;
+    };
+
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int done_fd = -1;   // eventfd, signalled by workers when a task is finished
+    std::unordered_map<uint64_t, Client> clients;
+    uint64_t next_client = 1;   // 0 stands for listen_fd and done_fd in epoll data
+
+    std::vector<std::thread> workers;
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<Task> tasks;
+    std::deque<Task> done;
+    bool stopping = false;
+
+    template <class F>
+    void workerLoop(F& executeLine) {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_ready.wait(lock, [this] () { return stopping || !tasks.empty(); });
+                if (stopping)
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+
+            output.captureInto(&task.result);
+            executeLine(task.line);
+            output.flush();
+            output.captureInto(nullptr);
+
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                done.push_back(std::move(task));
+            }
+
+            uint64_t one = 1;
+            ::write(done_fd, &one, sizeof(one));
+        }
+    }
+
+    static bool isThrottled(const Client& client) {
+        return client.lines.size() >= SERVER_MAX_LINES || client.lines_bytes >= SERVER_MAX_BUFFERED ||
+               client.out.size() >= SERVER_MAX_BUFFERED;
+    }
+
+    void pushLine(Client& client, std::string line) {
+        client.lines_bytes += line.size();
+        client.lines.push_back(std::move(line));
+    }
+
+    // client is watched for input until it's closing or has too much queued, and for output while there's some
+    void updateEvents(uint64_t id) {
+        auto& client = clients[id];
+        uint32_t events = (client.closing || isThrottled(client) ? 0u : (uint32_t)EPOLLIN) |
+                          (client.out.empty() ? 0u : (uint32_t)EPOLLOUT);
+        if (events == client.events)
+            return;
+
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = id;
+
+        if (!events)
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.fd, nullptr);
+        else
+            epoll_ctl(epoll_fd, client.events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, client.fd, &event);
+
+        client.events = events;
+    }
+
+    void drop(uint64_t id) {
+        auto& client = clients[id];
+        if (client.events)
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+        clients.erase(id);
+    }
+
+    // hands client's next line to workers, closes client once everything is answered
+    void schedule(uint64_t id) {
+        auto& client = clients[id];
+
+        // answered in its turn
+        while (!client.busy && !client.lines.empty() && client.lines.front() == SERVER_TOO_LONG) {
+            client.lines_bytes -= client.lines.front().size();
+            client.lines.pop_front();
+            client.out += "Line too long\n";
+            flushClient(id);
+        }
+
+        // answered the same way as stdin's exit
+        if (!client.busy && !client.lines.empty() && client.lines.front() == "exit") {
+            client.lines.clear();
+            client.lines_bytes = 0;
+            client.out += "exitting...";
+            flushClient(id);
+        }
+
+        // responses the client doesn't read hold its next line back
+        if (!client.busy && !client.lines.empty() && client.out.size() < SERVER_MAX_BUFFERED) {
+            client.busy = true;
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            client.lines_bytes -= client.lines.front().size();
+            tasks.push_back({id, std::move(client.lines.front()), {}});
+            client.lines.pop_front();
+            queue_ready.notify_one();
+            lock.unlock();
+
+            updateEvents(id);
+            return;
+        }
+
+        if (client.closing && !client.busy && client.lines.empty() && client.out.empty())
+            drop(id);
+    }
+
+    void flushClient(uint64_t id) {
+        auto& client = clients[id];
+
+        while (!client.out.empty()) {
+            auto result = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+            if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            if (result <= 0) {
+                // client is gone, nothing left to answer
+                client.out.clear();
+                client.lines.clear();
+                client.lines_bytes = 0;
+                client.closing = true;
+                break;
+            }
+            client.out.erase(0, result);
+        }
+
+        updateEvents(id);
+    }
+
+    void readClient(uint64_t id) {
+        auto& client = clients[id];
+        char buffer[SERVER_READ_BLOCK];
+
+        // hangups are reported even when input isn't watched, the rest is read once the client catches up
+        if (isThrottled(client))
+            return;
+
+        auto count = read(client.fd, buffer, sizeof(buffer));
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+
+        // last line could come without a newline
+        if (count <= 0) {
+            if (!client.closing && !client.skipping && !client.in.empty())
+                pushLine(client, std::move(client.in));
+            client.closing = true;
+            updateEvents(id);
+            return;
+        }
+
+        client.in.append(buffer, count);
+
+        size_t start = 0;
+        for (auto end = client.in.find('\n'); end != std::string::npos; end = client.in.find('\n', start)) {
+            auto line = client.in.substr(start, end - start);
+            start = end + 1;
+
+            if (client.closing)
+                continue;
+            if (client.skipping) {
+                client.skipping = false;
+                continue;
+            }
+            client.closing = line == "exit";
+            pushLine(client, std::move(line));
+        }
+        client.in.erase(0, start);
+
+        // a line which alone is over the limit is dropped up to its newline
+        if (client.in.size() >= SERVER_MAX_BUFFERED) {
+            if (!client.closing && !client.skipping)
+                pushLine(client, SERVER_TOO_LONG);
+            client.in.clear();
+            client.skipping = true;
+        }
+
+        updateEvents(id);
+    }
+
+    void acceptClients() {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+
+            auto id = next_client++;
+            clients[id].fd = fd;
+            updateEvents(id);
+        }
+    }
+
+    void collectDone() {
+        uint64_t count;
+        ::read(done_fd, &count, sizeof(count));
+
+        std::deque<Task> finished;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            finished.swap(done);
+        }
+
+        for (auto& task : finished) {
+            auto client = clients.find(task.client);
+            if (client == clients.end())
+                continue;
+
+            client->second.busy = false;
+            client->second.out += task.result;
+            flushClient(task.client);
+            schedule(task.client);
+        }
+    }
+
+public:
+    Server() = default;
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // returns false if the socket can't be set up, otherwise serves until SIGINT/SIGTERM
+    template <class F>
+    bool run(const char* path, size_t workers_count, F&& executeLine) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::string_view(path).size() >= sizeof(address.sun_path))
+            return false;
+        std::string_view(path).copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        unlink(path);
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listen_fd, 128) < 0) {
+            if (listen_fd >= 0)
+                ::close(listen_fd);
+            return false;
+        }
+
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = 0;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+        event.data.u64 = ~0ull;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, done_fd, &event);
+
+        server_stopping = false;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+
+        for (size_t i = 0; i < std::max((size_t)1, workers_count); i++)
+            workers.emplace_back([this, &executeLine] () { workerLoop(executeLine); });
+
+        epoll_event events[SERVER_MAX_EVENTS];
+        while (!server_stopping) {
+            int count = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, -1);
+
+            for (int i = 0; i < count; i++) {
+                auto id = events[i].data.u64;
+
+                if (id == 0)
+                    acceptClients();
+                else if (id == ~0ull)
+                    collectDone();
+                else if (clients.count(id)) {
+                    if (events[i].events & EPOLLOUT)
+                        flushClient(id);
+                    if (clients.count(id) && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+                        readClient(id);
+                    if (clients.count(id))
+                        schedule(id);
+                }
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            stopping = true;
+            queue_ready.notify_all();
+        }
+
+        for (auto& i : workers)
+            i.join();
+        workers.clear();
+
+        for (auto& i : clients)
+            ::close(i.second.fd);
+        clients.clear();
+
+        ::close(done_fd);
+        ::close(epoll_fd);
+        ::close(listen_fd);
+        unlink(path);
+        return true;
+    }
+};
@@ -0,0 +1,534 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <limits>
+#include <climits>
+#include <new>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "graph.hpp"
+#include "registry.hpp"
+
+// sharded execution: nodes are split between P worker processes (node v belongs to v % P),
+// each keeps out-edges of its own nodes only. workers exchange (node, distance) messages through
+// shared-memory rings, one per ordered pair of workers, which stand in for a network: nothing
+// else of a worker's state is visible to the others. algorithms proceed in supersteps:
+// every worker sends what its nodes found, a barrier, everyone drains its rings and updates
+// its nodes, and an all-reduce over the workers decides whether there's another step.
+//  SHARDED_BFS     level-synchronous BFS, prints what BFS does
+//  SHARDED_SSSP    delta-stepping (Meyer, Sanders): buckets of width delta are settled in order,
+//                  light edges (weight <= delta) repeatedly within a bucket, heavy ones once.
+//                  prints what DIJKSTRA does
+// workers are forked for a version of the graph the first time it's queried and are replaced
+// once it changes; --shards sets their count. a worker sleeps on a futex between queries
+
+#define SHARD_MAX_WORKERS 64
+#define SHARD_RING_SLOTS 4096           // messages a ring holds, power of two
+#define SHARD_WAIT_MS 100               // parent checks if workers are alive that often
+#define SHARD_DRAIN_MS 1                // a worker waiting for senders drains its rings that often
+
+inline void futexWait(std::atomic<uint32_t>& word, uint32_t value, long timeout_ms = -1) {
+    timespec timeout{timeout_ms / 1000, timeout_ms % 1000 * 1000000};
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, value, timeout_ms < 0 ? nullptr : &timeout, nullptr, 0);
+}
+
+inline void futexWake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+struct ShardMessage {
+    uint64_t node;
+    uint64_t distance;
+};
+
+// SpscRing's layout in shared memory: head and tail are process-shared atomics
+struct ShardRing {
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) ShardMessage slots[SHARD_RING_SLOTS];
+
+    bool tryPush(const ShardMessage& message) {
+        auto curr = tail.load(std::memory_order_relaxed);
+        if (curr - head.load(std::memory_order_acquire) == SHARD_RING_SLOTS)
+            return false;
+
+        slots[curr & (SHARD_RING_SLOTS - 1)] = message;
+        tail.store(curr + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(ShardMessage& message) {
+        auto curr = head.load(std::memory_order_relaxed);
+        if (curr == tail.load(std::memory_order_acquire))
+            return false;
+
+        message = slots[curr & (SHARD_RING_SLOTS - 1)];
+        head.store(curr + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+enum class ShardQuery : uint32_t {
+    BFS, SSSP, Exit
+};
+
+// shared region's header: the query, and the barrier and all-reduce slots of the workers
+struct ShardControl {
+    alignas(64) std::atomic<uint32_t> sequence{0};     // bumped by the parent for every query
+    ShardQuery query = ShardQuery::Exit;
+    uint64_t root = 0;
+    uint64_t delta = 1;
+
+    alignas(64) std::atomic<uint32_t> done{0};         // workers finished with the query
+
+    alignas(64) std::atomic<uint32_t> arrived{0};
+    alignas(64) std::atomic<uint32_t> generation{0};
+
+    // all-reduces alternate between two rows, so a row isn't written before everyone has read it
+    uint64_t reduce[2][SHARD_MAX_WORKERS] = {};
+};
+
+// nodes of one worker with their out-edges, global ids
+struct ShardPartition {
+    std::vector<uint64_t> offsets{0};
+    std::vector<uint64_t> targets;
+    std::vector<EDGE_WEIGHT_T> weights;
+};
+
+// what a worker sees: its partition and the shared region
+class ShardWorker {
+private:
+    ShardControl& control;
+    ShardRing* rings;               // rings[from * workers + to]
+    uint64_t* distances;            // results, every worker writes its own nodes'
+    const ShardPartition& partition;
+    size_t id;
+    size_t workers;
+    uint32_t reduces = 0;
+
+    std::vector<ShardMessage> inbox;
+
+    static constexpr uint64_t infinity = std::numeric_limits<uint64_t>::max();
+
+    uint64_t local(uint64_t node) const {
+        return node / workers;
+    }
+
+    uint64_t global(uint64_t node) const {
+        return node * workers + id;
+    }
+
+    size_t ownedCount() const {
+        return partition.offsets.size() - 1;
+    }
+
+    void drain() {
+        ShardMessage message;
+        for (size_t from = 0; from < workers; from++)
+            while (from != id && rings[from * workers + id].tryPop(message))
+                inbox.push_back(message);
+    }
+
+    // a full ring is waited out by draining own rings, so two workers sending to each other can't block.
+    // the receiver may be done sending and waiting in exchange(), it's woken to drain
+    void send(uint64_t node, uint64_t distance) {
+        auto to = node % workers;
+        if (to == id) {
+            inbox.push_back({node, distance});
+            return;
+        }
+
+        while (!rings[id * workers + to].tryPush({node, distance})) {
+            drain();
+            futexWake(control.generation);
+            sched_yield();
+        }
+    }
+
+    // draining workers keep emptying their rings while they wait: that's only done at the end
+    // of a superstep, when the others may still be sending but none has gone on to the next one
+    void barrier(bool draining = false) {
+        auto generation = control.generation.load(std::memory_order_acquire);
+        if (control.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == workers) {
+            control.arrived.store(0, std::memory_order_relaxed);
+            control.generation.fetch_add(1, std::memory_order_release);
+            futexWake(control.generation);
+            return;
+        }
+
+        while (control.generation.load(std::memory_order_acquire) == generation) {
+            if (draining)
+                drain();
+            futexWait(control.generation, generation, draining ? SHARD_DRAIN_MS : -1);
+        }
+    }
+
+    // end of a superstep: sent messages are in the rings once everyone's here
+    void exchange() {
+        barrier(true);
+        drain();
+    }
+
+    template <class F>
+    uint64_t allReduce(uint64_t value, F&& combine) {
+        auto& row = control.reduce[reduces++ % 2];
+        row[id] = value;
+        barrier();
+
+        auto result = row[0];
+        for (size_t i = 1; i < workers; i++)
+            result = combine(result, row[i]);
+        return result;
+    }
+
+    uint64_t sum(uint64_t value) {
+        return allReduce(value, [] (uint64_t lhs, uint64_t rhs) { return lhs + rhs; });
+    }
+
+    uint64_t minimum(uint64_t value) {
+        return allReduce(value, [] (uint64_t lhs, uint64_t rhs) { return std::min(lhs, rhs); });
+    }
+
+    void bfs(uint64_t root) {
+        std::vector<uint64_t> hops(ownedCount(), infinity);
+        std::vector<uint64_t> frontier, next;
+        if (root % workers == id) {
+            hops[local(root)] = 0;
+            frontier.push_back(local(root));
+        }
+
+        for (uint64_t level = 1; ; level++) {
+            inbox.clear();
+            for (auto node : frontier)
+                for (auto e = partition.offsets[node]; e < partition.offsets[node + 1]; e++)
+                    send(partition.targets[e], level);
+            exchange();
+
+            next.clear();
+            for (auto& message : inbox)
+                if (hops[local(message.node)] == infinity) {
+                    hops[local(message.node)] = level;
+                    next.push_back(local(message.node));
+                }
+
+            if (!sum(next.size()))
+                break;
+            std::swap(frontier, next);
+        }
+
+        for (uint64_t i = 0; i < ownedCount(); i++)
+            distances[global(i)] = hops[i];
+    }
+
+    void sssp(uint64_t root, uint64_t delta) {
+        std::vector<uint64_t> tentative(ownedCount(), infinity);
+        std::map<uint64_t, std::vector<uint64_t>> buckets;     // entries whose distance moved on are stale
+        std::vector<uint64_t> settled;
+        std::vector<uint8_t> is_settled(ownedCount(), false);
+
+        auto relax = [&] () {
+            for (auto& message : inbox) {
+                auto node = local(message.node);
+                if (message.distance < tentative[node]) {
+                    tentative[node] = message.distance;
+                    buckets[message.distance / delta].push_back(node);
+                }
+            }
+            inbox.clear();
+        };
+
+        // first bucket holding a node which still belongs there
+        auto firstBucket = [&] () {
+            while (!buckets.empty()) {
+                auto& [index, nodes] = *buckets.begin();
+                for (auto node : nodes)
+                    if (tentative[node] / delta == index)
+                        return index;
+                buckets.erase(buckets.begin());
+            }
+            return infinity;
+        };
+
+        auto sendEdges = [&] (uint64_t node, bool light) {
+            for (auto e = partition.offsets[node]; e < partition.offsets[node + 1]; e++)
+                if ((partition.weights[e] <= delta) == light)
+                    send(partition.targets[e], tentative[node] + partition.weights[e]);
+        };
+
+        if (root % workers == id) {
+            tentative[local(root)] = 0;
+            buckets[0].push_back(local(root));
+        }
+
+        for (uint64_t bucket; (bucket = minimum(firstBucket())) != infinity; ) {
+            for (auto node : settled)
+                is_settled[node] = false;
+            settled.clear();
+
+            // light edges may bring nodes back into the bucket
+            for (;;) {
+                std::vector<uint64_t> nodes;
+                auto found = buckets.find(bucket);
+                if (found != buckets.end()) {
+                    nodes.swap(found->second);
+                    buckets.erase(found);
+                }
+
+                for (auto node : nodes) {
+                    if (tentative[node] / delta != bucket)
+                        continue;
+                    if (!is_settled[node]) {
+                        is_settled[node] = true;
+                        settled.push_back(node);
+                    }
+                    sendEdges(node, true);
+                }
+                exchange();
+                relax();
+
+                auto found_again = buckets.find(bucket);
+                if (!sum(found_again != buckets.end() && !found_again->second.empty()))
+                    break;
+            }
+
+            for (auto node : settled)
+                sendEdges(node, false);
+            exchange();
+            relax();
+        }
+
+        for (uint64_t i = 0; i < ownedCount(); i++)
+            distances[global(i)] = tentative[i];
+    }
+
+public:
+    ShardWorker(ShardControl& control, ShardRing* rings, uint64_t* distances, const ShardPartition& partition,
+                size_t id, size_t workers) :
+        control(control), rings(rings), distances(distances), partition(partition), id(id), workers(workers) {}
+
+    // serves queries until the parent says Exit
+    void run() {
+        uint32_t seen = 0;
+        for (;;) {
+            uint32_t sequence;
+            while ((sequence = control.sequence.load(std::memory_order_acquire)) == seen)
+                futexWait(control.sequence, seen);
+            seen = sequence;
+
+            if (control.query == ShardQuery::Exit)
+                return;
+
+            inbox.clear();
+            if (control.query == ShardQuery::BFS)
+                bfs(control.root);
+            else
+                sssp(control.root, control.delta);
+
+            if (control.done.fetch_add(1, std::memory_order_acq_rel) + 1 == workers)
+                futexWake(control.done);
+        }
+    }
+};
+
+// the parent's side: forks the workers and hands queries to them, one at a time
+class ShardedEngine {
+private:
+    std::mutex mutex;
+    size_t workers_count = 2;
+
+    std::vector<pid_t> workers;
+    uint64_t version = 0;
+    size_t nodes_count = 0;
+    uint64_t delta = 1;
+
+    void* region = nullptr;
+    size_t region_size = 0;
+    ShardControl* control = nullptr;
+    ShardRing* rings = nullptr;
+    uint64_t* distances = nullptr;
+
+    // light edges are those of at most delta: the heaviest edge over the average out-degree
+    static uint64_t chooseDelta(Graph& graph) {
+        uint64_t heaviest = 1;
+        for (uns long i = 0; i < graph.getEdgesCount(); i++)
+            heaviest = std::max<uint64_t>(heaviest, graph.getEdge(i)->getWeight());
+
+        auto degree = std::max<uint64_t>(1, graph.getEdgesCount() / std::max<uint64_t>(1, graph.getNodesCount()));
+        return std::max<uint64_t>(1, heaviest / degree);
+    }
+
+    static ShardPartition partition(Graph& graph, size_t id, size_t count) {
+        ShardPartition result;
+        for (uns long node = id; node < graph.getNodesCount(); node += count) {
+            for (auto i : graph.getNode(node)->getOutEdges()) {
+                result.targets.push_back(i->getDrain()->getId());
+                result.weights.push_back(i->getWeight());
+            }
+            result.offsets.push_back(result.targets.size());
+        }
+        return result;
+    }
+
+    void stop() {
+        if (workers.empty())
+            return;
+
+        control->query = ShardQuery::Exit;
+        control->sequence.fetch_add(1, std::memory_order_release);
+        futexWake(control->sequence);
+        for (auto pid : workers)
+            waitpid(pid, nullptr, 0);
+        workers.clear();
+
+        munmap(region, region_size);
+        region = nullptr;
+    }
+
+    // a worker is forked right after its partition is built, so the parent holds one at a time
+    bool start(Graph& graph) {
+        stop();
+        nodes_count = graph.getNodesCount();
+        version = graph.getVersion();
+        delta = chooseDelta(graph);
+
+        auto rings_offset = (sizeof(ShardControl) + 63) / 64 * 64;
+        auto distances_offset = rings_offset + sizeof(ShardRing) * workers_count * workers_count;
+        region_size = distances_offset + sizeof(uint64_t) * std::max<size_t>(1, nodes_count);
+        region = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            region = nullptr;
+            return false;
+        }
+
+        control = new (region) ShardControl();
+        rings = (ShardRing*)((char*)region + rings_offset);
+        for (size_t i = 0; i < workers_count * workers_count; i++)
+            new (rings + i) ShardRing();
+        distances = (uint64_t*)((char*)region + distances_offset);
+
+        auto parent = getpid();
+        for (size_t id = 0; id < workers_count; id++) {
+            auto own = partition(graph, id, workers_count);
+
+            auto pid = fork();
+            if (pid == 0) {
+                // a worker doesn't outlive the engine nor holds its files (server's sockets) open
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                if (getppid() != parent)
+                    _exit(1);
+                close_range(3, ~0u, 0);
+
+                ShardWorker(*control, rings, distances, own, id, workers_count).run();
+                _exit(0);
+            }
+
+            if (pid < 0) {
+                stop();
+                return false;
+            }
+            workers.push_back(pid);
+        }
+
+        return true;
+    }
+
+    // false if a worker is gone, the rest are stopped then
+    bool wait() {
+        for (uint32_t done; (done = control->done.load(std::memory_order_acquire)) != workers.size(); ) {
+            futexWait(control->done, done, SHARD_WAIT_MS);
+
+            for (auto pid : workers)
+                if (waitpid(pid, nullptr, WNOHANG) != 0) {
+                    for (auto& i : workers)
+                        if (i != pid)
+                            kill(i, SIGKILL);
+                    for (auto i : workers)
+                        if (i != pid)
+                            waitpid(i, nullptr, 0);
+                    workers.clear();
+                    munmap(region, region_size);
+                    region = nullptr;
+                    return false;
+                }
+        }
+
+        return true;
+    }
+
+public:
+    ~ShardedEngine() {
+        stop();
+    }
+
+    void setWorkers(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        count = std::clamp<size_t>(count, 1, SHARD_MAX_WORKERS);
+        if (count != workers_count)
+            stop();
+        workers_count = count;
+    }
+
+    // distances from root (infinity if unreachable), false if workers couldn't run the query
+    bool run(Graph& graph, ShardQuery query, uns long root, std::vector<uint64_t>& result) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (workers.empty() || version != graph.getVersion() || nodes_count != graph.getNodesCount())
+            if (!start(graph))
+                return false;
+
+        control->query = query;
+        control->root = root;
+        control->delta = delta;
+        control->done.store(0, std::memory_order_relaxed);
+        control->sequence.fetch_add(1, std::memory_order_release);
+        futexWake(control->sequence);
+
+        if (!wait())
+            return false;
+
+        result.assign(distances, distances + nodes_count);
+        return true;
+    }
+};
+
+// shared by everything in the process
+inline ShardedEngine sharded_engine;
+
+// prints distances the way BFS and DIJKSTRA do
+inline void shardedDistances(Graph& graph, ShardQuery query, Node* root) {
+    static thread_local std::vector<uint64_t> distances;
+    if (!sharded_engine.run(graph, query, root->getId(), distances)) {
+        output << "Shard workers failed" << '\n';
+        return;
+    }
+
+    for (uns long i = 0; i < graph.getNodesCount(); i++) {
+        if (i == root->getId())
+            continue;
+
+        output << graph.getNode(i)->getMark() << " ";
+        if (distances[i] == std::numeric_limits<uint64_t>::max())
+            output << "inf";
+        else
+            output << distances[i];
+        output << '\n';
+    }
+}
+
+inline void registerSharded(AlgorithmRegistry& registry) {
+    registry.add("SHARDED_BFS", 1, true, [] (Graph& graph, Node* const* nodes) {
+        shardedDistances(graph, ShardQuery::BFS, nodes[0]);
+    });
+    registry.add("SHARDED_SSSP", 1, true, [] (Graph& graph, Node* const* nodes) {
+        shardedDistances(graph, ShardQuery::SSSP, nodes[0]);
+    });
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// binary graph snapshot, all sections are 8-byte aligned and follow the header:
+//   mark_offsets  uint64[nodes + 1]   where node's mark starts in marks
+//   marks         char[marks_bytes]   string table, marks aren't terminated
+//   offsets       uint64[nodes + 1]   CSR: node's out edges are [offsets[i], offsets[i + 1])
+//   targets       uint64[edges]       drains' ids
+//   weights       weight_t[edges]
+// every section has its own checksum, header has one too
+
+#define SNAPSHOT_MAGIC "GRAPHSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_SECTIONS 5
+
+enum class SnapshotResult {
+    Done, Failed, Corrupted
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t weight_size;
+    uint64_t nodes_count;
+    uint64_t edges_count;
+    uint64_t marks_bytes;
+    uint64_t checksums[SNAPSHOT_SECTIONS];
+    uint64_t header_checksum;   // of everything above
+};
+
+inline size_t alignSection(size_t bytes) {
+    return (bytes + 7) & ~(size_t)7;
+}
+
+// word-wise multiplicative hash, tail bytes are folded in one by one
+inline uint64_t snapshotChecksum(const void* data, size_t size) {
+    auto bytes = (const unsigned char*)data;
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+
+    for (; i < size; i++)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+}
+
+template <class Graph>
+SnapshotResult saveSnapshot(Graph& graph, const std::string& path) {
+    typedef decltype(graph.getEdge(0)->getWeight()) Weight;
+    auto nodes_count = graph.getNodesCount();
+
+    std::vector<uint64_t> mark_offsets(nodes_count + 1, 0);
+    std::string marks;
+    std::vector<uint64_t> offsets(nodes_count + 1, 0);
+    std::vector<uint64_t> targets;
+    std::vector<Weight> weights;
+    targets.reserve(graph.getEdgesCount());
+    weights.reserve(graph.getEdgesCount());
+
+    for (uint64_t i = 0; i < nodes_count; i++) {
+        auto node = graph.getNode(i);
+        marks += MarkText(node->getMark()).view();
+        mark_offsets[i + 1] = marks.size();
+
+        for (auto e : node->getOutEdges()) {
+            targets.push_back(e->getDrain()->getId());
+            weights.push_back(e->getWeight());
+        }
+        offsets[i + 1] = targets.size();
+    }
+
+    const void* sections[SNAPSHOT_SECTIONS] = {mark_offsets.data(), marks.data(), offsets.data(),
+                                               targets.data(), weights.data()};
+    size_t sizes[SNAPSHOT_SECTIONS] = {mark_offsets.size() * sizeof(uint64_t), marks.size(),
+                                       offsets.size() * sizeof(uint64_t), targets.size() * sizeof(uint64_t),
+                                       weights.size() * sizeof(Weight)};
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, 8);
+    header.version = SNAPSHOT_VERSION;
+    header.weight_size = sizeof(Weight);
+    header.nodes_count = nodes_count;
+    header.edges_count = targets.size();
+    header.marks_bytes = marks.size();
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++)
+        header.checksums[i] = snapshotChecksum(sections[i], sizes[i]);
+    header.header_checksum = snapshotChecksum(&header, offsetof(SnapshotHeader, header_checksum));
+
+    // written to a temporary file first, so a failed SAVE never leaves a broken snapshot behind
+    auto temp_path = path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file)
+        return SnapshotResult::Failed;
+
+    static const char padding[8] = {};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < SNAPSHOT_SECTIONS; i++) {
+        ok = !sizes[i] || fwrite(sections[i], sizes[i], 1, file) == 1;
+        if (ok && alignSection(sizes[i]) != sizes[i])
+            ok = fwrite(padding, alignSection(sizes[i]) - sizes[i], 1, file) == 1;
+    }
+
+    ok = fflush(file) == 0 && ok;
+    ok = fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return SnapshotResult::Failed;
+    }
+
+    return SnapshotResult::Done;
+}
+
+// graph is replaced only when the whole snapshot is valid.
+// arrays are read right from the mapping: nodes and edges are created by id, nothing is parsed
+template <class Graph>
+SnapshotResult loadSnapshot(Graph& graph, const std::string& path) {
+    typedef decltype(graph.getEdge(0)->getWeight()) Weight;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return SnapshotResult::Failed;
+
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        return SnapshotResult::Failed;
+    }
+
+    if ((size_t)info.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return SnapshotResult::Corrupted;
+    }
+
+    size_t size = info.st_size;
+    auto data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return SnapshotResult::Failed;
+
+    auto result = SnapshotResult::Corrupted;
+    SnapshotHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    size_t sizes[SNAPSHOT_SECTIONS] = {(header.nodes_count + 1) * sizeof(uint64_t), header.marks_bytes,
+                                       (header.nodes_count + 1) * sizeof(uint64_t),
+                                       header.edges_count * sizeof(uint64_t), header.edges_count * sizeof(Weight)};
+    const char* sections[SNAPSHOT_SECTIONS];
+
+    size_t expected_size = sizeof(header);
+    for (size_t i = 0; i < SNAPSHOT_SECTIONS; i++) {
+        sections[i] = data + expected_size;
+        expected_size += alignSection(sizes[i]);
+    }
+
+    bool valid = std::memcmp(header.magic, SNAPSHOT_MAGIC, 8) == 0 && header.version == SNAPSHOT_VERSION &&
+                 header.weight_size == sizeof(Weight) &&
+                 header.header_checksum == snapshotChecksum(&header, offsetof(SnapshotHeader, header_checksum)) &&
+                 expected_size == size;
+
+    for (size_t i = 0; valid && i < SNAPSHOT_SECTIONS; i++)
+        valid = header.checksums[i] == snapshotChecksum(sections[i], sizes[i]);
+
+    if (valid) {
+        madvise((void*)data, size, MADV_SEQUENTIAL);
+
+        auto mark_offsets = (const uint64_t*)sections[0];
+        auto marks = sections[1];
+        auto offsets = (const uint64_t*)sections[2];
+        auto targets = (const uint64_t*)sections[3];
+        auto weights = (const Weight*)sections[4];
+
+        // checksums can't catch a snapshot which was written wrong in the first place
+        for (uint64_t i = 0; valid && i < header.nodes_count; i++)
+            valid = mark_offsets[i] <= mark_offsets[i + 1] && mark_offsets[i + 1] <= header.marks_bytes &&
+                    offsets[i] <= offsets[i + 1] && offsets[i + 1] <= header.edges_count;
+
+        for (uint64_t i = 0; valid && i < header.edges_count; i++)
+            valid = targets[i] < header.nodes_count;
+
+        if (valid) {
+            graph.clear();
+
+            for (uint64_t i = 0; i < header.nodes_count; i++)
+                graph.appendNode(std::string_view(marks + mark_offsets[i], mark_offsets[i + 1] - mark_offsets[i]));
+
+            for (uint64_t i = 0; i < header.nodes_count; i++)
+                for (auto e = offsets[i]; e < offsets[i + 1]; e++)
+                    graph.connect(graph.getNode(i), graph.getNode(targets[e]), weights[e]);
+
+            result = SnapshotResult::Done;
+        }
+    }
+
+    munmap((void*)data, size);
+    return result;
+}
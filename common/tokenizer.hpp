@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string_view>
+#include <charconv>
+
+// splits a line into space separated tokens, which are views over line's buffer:
+// nothing is copied, so line must outlive the tokenizer.
+// mimics the queue interface command loop used to work with
+class Tokenizer {
+private:
+    std::string_view line;
+    std::string_view current;
+    size_t pos = 0;
+
+    void advance() {
+        while (pos < line.size() && line[pos] == ' ')
+            pos++;
+
+        auto end = line.find(' ', pos);
+        if (end == std::string_view::npos)
+            end = line.size();
+
+        current = line.substr(pos, end - pos);
+        pos = end;
+    }
+
+public:
+    explicit Tokenizer(std::string_view line) : line(line) {
+        advance();
+    }
+
+    bool empty() const {
+        return current.empty();
+    }
+
+    // empty view once tokens are exhausted
+    std::string_view front() const {
+        return current;
+    }
+
+    void pop() {
+        advance();
+    }
+};
+
+// whole token must be a number, otherwise false is returned and value is untouched
+template <class T>
+bool parseNumber(std::string_view token, T& value) {
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+// versions of the served graph: a query pins the current version and runs on it without
+// locks, a writer changes only a version nobody else holds. when queries still hold the
+// current one, the writer clones it and publishes its copy once the line is done, so a long
+// MAX FLOW neither blocks writers nor sees ids renumbered under it. unpinned current version
+// is changed in place, new pins wait for that line only.
+// versions are reference counted, each is freed by whoever drops it last
+
+// version the thread's line is pinned to: nobody changes it, so a command may keep it
+// after the line (FORK does). empty while a line may change the graph in place
+template <class Graph>
+inline thread_local std::shared_ptr<Graph> line_version;
+
+template <class Graph>
+class GraphVersions {
+private:
+    std::mutex mutex;
+    std::condition_variable published;
+    std::shared_ptr<Graph> current;
+    bool writing = false;   // current is changed in place
+
+public:
+    explicit GraphVersions(std::shared_ptr<Graph> first) : current(std::move(first)) {}
+
+    GraphVersions(const GraphVersions&) = delete;
+    GraphVersions& operator=(const GraphVersions&) = delete;
+
+    // pinned version must only be read
+    std::shared_ptr<Graph> pin() {
+        std::unique_lock<std::mutex> lock(mutex);
+        published.wait(lock, [this] () { return !writing; });
+        return current;
+    }
+
+    // graph a writer may change, writers must come one at a time
+    std::shared_ptr<Graph> beginWrite() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (current.use_count() == 1) {
+            writing = true;
+            return current;
+        }
+
+        // pinned versions are read-only, so it's copied without holding anybody
+        auto base = current;
+        lock.unlock();
+        return base->clone();
+    }
+
+    // makes the written graph current
+    void endWrite(std::shared_ptr<Graph> version) {
+        // replaced version is freed (if it's the last reference) after the lock is released
+        auto previous = std::move(version);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            current.swap(previous);
+            writing = false;
+        }
+        published.notify_all();
+    }
+};
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "snapshot.hpp"
+#include "output.hpp"
+
+// append-only log of applied mutations, so the graph survives a crash.
+// records are collected in memory and committed (written and fsynced) as a group,
+// once LOG_GROUP_RECORDS are pending or LOG_GROUP_MS passed since the first of them.
+//
+// the log continues a snapshot stored next to it (<log>.snap): log's header holds
+// the snapshot's checksum, so a log left behind by an interrupted checkpoint is ignored.
+// every record is [uint32 size][uint32 checksum][uint8 type][fields], a torn tail is cut off
+
+#define LOG_MAGIC "GRAPHWAL"
+#define LOG_VERSION 1
+#define LOG_GROUP_RECORDS 1024
+#define LOG_GROUP_MS 10
+
+struct LogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t snapshot_id;   // header checksum of the snapshot, 0 if there's none
+};
+
+enum class LogRecord : uint8_t {
+    Node = 1, Edge, RemoveNode, RemoveEdge
+};
+
+// id of the snapshot at path, 0 if it's missing or unreadable
+inline uint64_t snapshotId(const std::string& path) {
+    SnapshotHeader header;
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    bool ok = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+    return ok ? header.header_checksum : 0;
+}
+
+class MutationLog {
+private:
+    int fd = -1;
+    std::string path;
+    size_t group_records = LOG_GROUP_RECORDS;
+    std::chrono::milliseconds group_time{LOG_GROUP_MS};
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::vector<char> pending;
+    size_t pending_records = 0;
+    std::chrono::steady_clock::time_point first_pending;
+    std::thread committer;
+    bool stopping = false;
+    std::atomic<bool> failed{false};
+
+    void put(const void* data, size_t size) {
+        pending.insert(pending.end(), (const char*)data, (const char*)data + size);
+    }
+
+    void putString(std::string_view text) {
+        uint32_t size = text.size();
+        put(&size, sizeof(size));
+        put(text.data(), text.size());
+    }
+
+    // record is assembled right in pending, size and checksum are patched in afterwards
+    template <class F>
+    void append(LogRecord type, F&& fields) {
+        if (fd < 0)
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        auto start = pending.size();
+        uint32_t prefix[2] = {0, 0};
+        put(prefix, sizeof(prefix));
+        put(&type, sizeof(type));
+        fields();
+
+        prefix[0] = pending.size() - start - sizeof(prefix);
+        prefix[1] = (uint32_t)snapshotChecksum(pending.data() + start + sizeof(prefix), prefix[0]);
+        std::memcpy(pending.data() + start, prefix, sizeof(prefix));
+
+        if (pending_records++ == 0) {
+            first_pending = std::chrono::steady_clock::now();
+            wakeup.notify_one();
+        }
+
+        if (pending_records >= group_records)
+            commitLocked();
+    }
+
+    // what couldn't be written stays pending for the next commit. a failed write or sync
+    // marks the log failed: the graph may be ahead of what could be recovered from it
+    void commitLocked() {
+        if (pending.empty())
+            return;
+
+        size_t written = 0;
+        while (written < pending.size()) {
+            auto result = ::write(fd, pending.data() + written, pending.size() - written);
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result <= 0)
+                break;
+            written += result;
+        }
+
+        pending.erase(pending.begin(), pending.begin() + written);
+        if (fdatasync(fd) != 0 || !pending.empty())
+            failed = true;
+
+        // the committer retries the rest once group_time passes again
+        if (!pending.empty()) {
+            first_pending = std::chrono::steady_clock::now();
+            return;
+        }
+
+        pending_records = 0;
+    }
+
+    // commits groups which waited for group_time
+    void committerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (!stopping) {
+            if (!pending_records) {
+                wakeup.wait(lock);
+                continue;
+            }
+
+            if (wakeup.wait_until(lock, first_pending + group_time) == std::cv_status::timeout)
+                commitLocked();
+        }
+    }
+
+    static bool readString(const char*& data, const char* end, std::string_view& text) {
+        uint32_t size;
+        if (end - data < (long)sizeof(size))
+            return false;
+        std::memcpy(&size, data, sizeof(size));
+        data += sizeof(size);
+
+        if (end - data < (long)size)
+            return false;
+        text = std::string_view(data, size);
+        data += size;
+        return true;
+    }
+
+    // creates an empty log continuing snapshot_id, replacing the current one
+    bool reset(uint64_t snapshot_id) {
+        LogHeader header{};
+        std::memcpy(header.magic, LOG_MAGIC, 8);
+        header.version = LOG_VERSION;
+        header.snapshot_id = snapshot_id;
+
+        auto temp_path = path + ".tmp";
+        int temp = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (temp < 0)
+            return false;
+
+        bool ok = ::write(temp, &header, sizeof(header)) == sizeof(header) && fsync(temp) == 0;
+        ::close(temp);
+
+        if (!ok || rename(temp_path.c_str(), path.c_str()) != 0)
+            return false;
+
+        if (fd >= 0)
+            ::close(fd);
+        fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        return fd >= 0;
+    }
+
+public:
+    MutationLog() = default;
+
+    MutationLog(const MutationLog&) = delete;
+    MutationLog& operator=(const MutationLog&) = delete;
+
+    ~MutationLog() {
+        close();
+    }
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    // a commit couldn't write or sync the log, mutations are refused until a checkpoint succeeds
+    bool hasFailed() const {
+        return failed;
+    }
+
+    void setGroup(size_t records, size_t ms) {
+        group_records = std::max((size_t)1, records);
+        group_time = std::chrono::milliseconds(ms);
+    }
+
+    std::string snapshotPath() const {
+        return path + ".snap";
+    }
+
+    // recovers graph from the snapshot and log's tail, then keeps logging into the same file
+    template <class Graph>
+    bool open(Graph& graph, const std::string& log_path) {
+        path = log_path;
+
+        auto snapshot_id = snapshotId(snapshotPath());
+        if (snapshot_id && loadSnapshot(graph, snapshotPath()) != SnapshotResult::Done)
+            return false;
+
+        // log is read whole, it's only as long as mutations since the last checkpoint
+        std::vector<char> data;
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file) {
+            char buffer[1 << 16];
+            size_t count;
+            while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+                data.insert(data.end(), buffer, buffer + count);
+            fclose(file);
+        }
+
+        LogHeader header;
+        if (data.size() < sizeof(header)) {
+            if (!reset(snapshot_id))
+                return false;
+        } else {
+            std::memcpy(&header, data.data(), sizeof(header));
+            if (std::memcmp(header.magic, LOG_MAGIC, 8) != 0 || header.version != LOG_VERSION)
+                return false;
+
+            size_t valid_size = sizeof(header);
+            if (header.snapshot_id == snapshot_id)
+                valid_size = replay(graph, data);
+
+            // the log belongs to an older snapshot, which already holds its records
+            if (header.snapshot_id != snapshot_id) {
+                if (!reset(snapshot_id))
+                    return false;
+            } else {
+                if (truncate(path.c_str(), valid_size) != 0)
+                    return false;
+                fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+                if (fd < 0)
+                    return false;
+            }
+        }
+
+        stopping = false;
+        committer = std::thread(&MutationLog::committerLoop, this);
+        return true;
+    }
+
+    // applies records to the graph, returns size of the valid part of the log.
+    // NODE/EDGE runs go through bulk build and runs of node removals are compacted at once,
+    // output is muted since every record was already reported when it was first applied
+    template <class Graph>
+    size_t replay(Graph& graph, const std::vector<char>& data) {
+        const char* begin = data.data();
+        const char* end = begin + data.size();
+        const char* curr = begin + sizeof(LogHeader);
+        std::vector<typename Graph::BuildCommand> run;
+        std::vector<std::string_view> removals;
+
+        output.flush();
+        output.setMuted(true);
+
+        while (end - curr >= 8) {
+            uint32_t prefix[2];
+            std::memcpy(prefix, curr, sizeof(prefix));
+            const char* record = curr + sizeof(prefix);
+
+            if (end - record < (long)prefix[0] || prefix[0] == 0 ||
+                (uint32_t)snapshotChecksum(record, prefix[0]) != prefix[1])
+                break;
+
+            const char* record_end = record + prefix[0];
+            auto type = (LogRecord)*record++;
+            std::string_view src, drain;
+            typename Graph::BuildCommand command;
+
+            bool ok = readString(record, record_end, src);
+            if (ok && (type == LogRecord::Edge || type == LogRecord::RemoveEdge))
+                ok = readString(record, record_end, drain);
+            if (ok && type == LogRecord::Edge) {
+                uint32_t weight;
+                ok = record_end - record == sizeof(weight);
+                if (ok) {
+                    std::memcpy(&weight, record, sizeof(weight));
+                    command.weight = weight;
+                }
+            }
+
+            if (!ok)
+                break;
+
+            if (type == LogRecord::Node || type == LogRecord::Edge) {
+                graph.removeNodes(removals);
+                removals.clear();
+
+                command.is_edge = type == LogRecord::Edge;
+                command.src = src;
+                command.drain = drain;
+                run.push_back(command);
+            } else {
+                graph.bulkBuild(run);
+                run.clear();
+
+                if (type == LogRecord::RemoveNode) {
+                    removals.push_back(src);
+                    curr = record_end;
+                    continue;
+                }
+
+                graph.removeNodes(removals);
+                removals.clear();
+                if (graph.getNode(src) && graph.getNode(drain))
+                    graph.disconnect(graph.getNode(src), graph.getNode(drain));
+            }
+
+            curr = record_end;
+        }
+
+        graph.bulkBuild(run);
+        graph.removeNodes(removals);
+        output.flush();
+        output.setMuted(false);
+
+        return curr - begin;
+    }
+
+    void node(std::string_view mark) {
+        append(LogRecord::Node, [&] () {
+            putString(mark);
+        });
+    }
+
+    void edge(std::string_view src, std::string_view drain, uint32_t weight) {
+        append(LogRecord::Edge, [&] () {
+            putString(src);
+            putString(drain);
+            put(&weight, sizeof(weight));
+        });
+    }
+
+    void removeNode(std::string_view mark) {
+        append(LogRecord::RemoveNode, [&] () {
+            putString(mark);
+        });
+    }
+
+    void removeEdge(std::string_view src, std::string_view drain) {
+        append(LogRecord::RemoveEdge, [&] () {
+            putString(src);
+            putString(drain);
+        });
+    }
+
+    void commit() {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (fd >= 0)
+            commitLocked();
+    }
+
+    // snapshot of the current graph replaces the log
+    template <class Graph>
+    bool checkpoint(Graph& graph) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (fd < 0)
+            return false;
+
+        // the snapshot holds whatever a failed log couldn't
+        commitLocked();
+        if (saveSnapshot(graph, snapshotPath()) != SnapshotResult::Done || !reset(snapshotId(snapshotPath())))
+            return false;
+
+        pending.clear();
+        pending_records = 0;
+        failed = false;
+        return true;
+    }
+
+    void close() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (fd >= 0)
+                commitLocked();
+            stopping = true;
+            wakeup.notify_one();
+        }
+
+        if (committer.joinable())
+            committer.join();
+
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+};
+
+// shared by the command loop, stays closed (and ignores mutations) unless --log is given
+inline MutationLog mutation_log;
@@ -0,0 +1,26 @@
+#include "../1.1/components.hpp"
+#include "../1.2/dijkstra.hpp"
+#include "../1.3/bfs.hpp"
+#include "../1.3/max_flow.hpp"
+#include "../1.3/flow_forks.hpp"
+#include "../1.4/tarjan.hpp"
+#include "../1.4/reachability.hpp"
+#include "../common/engine.hpp"
+#include "../common/sharded.hpp"
+
+
+// every algorithm over one graph, so it's ingested once for all of them
+int main(int argc, char** argv) {
+    AlgorithmRegistry registry;
+    registerRPO(registry);
+    registerComponents(registry);
+    registerDijkstra(registry);
+    registerBFS(registry);
+    registerMaxFlow(registry);
+    registerFlowForks(registry);
+    registerTarjan(registry);
+    registerReachability(registry);
+    registerSharded(registry);
+
+    return runEngine(argc, argv, registry);
+}
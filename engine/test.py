@@ -0,0 +1,570 @@
+import random
+import os
+import re
+import shutil
+import signal
+import resource
+import socket
+import threading
+import time
+import subprocess
+from itertools import permutations
+
+# checks of what the engine does besides algorithms (those are checked against NetworkX by tasks' tests):
+# every case runs bin/main on generated commands and compares its output with another run of bin/main
+# which must print the same, e.g. queries after SAVE and LOAD with queries before them
+
+def generate_graph(num_nodes, num_edges, weight_range=(1, 100), prefix=""):
+    nodes = [f"{prefix}{i}" for i in range(num_nodes)]
+    commands = [f"NODE {node}" for node in nodes]
+
+    possible_edges = list(permutations(nodes, 2))
+    random.shuffle(possible_edges)
+    for a, b in possible_edges[:num_edges]:
+        commands.append(f"EDGE {a} {b} {random.randint(weight_range[0], weight_range[1])}")
+
+    return nodes, commands
+
+
+# removals of random nodes and edges, the graph's commands are in the order they were generated
+def generate_removals(nodes, commands, remove_prob=0.1):
+    edges = [cmd.split()[1:3] for cmd in commands if cmd.startswith("EDGE")]
+    removals = [f"REMOVE EDGE {a} {b}" for a, b in edges if random.random() < remove_prob]
+    removals += [f"REMOVE NODE {node}" for node in nodes[1:] if random.random() < remove_prob]
+    return removals
+
+
+# query of every algorithm, each one prints a line per node or one line
+def generate_queries(nodes):
+    src, sink = random.sample(nodes, 2)
+    return [f"RPO_NUMBERING {src}", f"BFS {src}", f"DIJKSTRA {src}", f"TARJAN {src}", "COMPONENTS",
+            f"MAX FLOW {src} {sink}", f"REACH {src} {sink}"]
+
+
+def write_file(filename, commands):
+    with open(filename, 'w') as f:
+        for cmd in commands:
+            f.write(cmd + '\n')
+
+
+def run(commands, args=[]):
+    return subprocess.run(["bin/main"] + args, input="\n".join(commands) + "\n",
+                          capture_output=True, text=True, timeout=60).stdout
+
+
+# runs lines one at a time and kills the engine, as a crash would, once it answered the last one
+def run_killed(commands, args):
+    process = subprocess.Popen(["bin/main", "--interactive"] + args, stdin=subprocess.PIPE,
+                               stdout=subprocess.PIPE, text=True)
+    process.stdin.write("\n".join(commands) + "\nBFS last_line\n")
+    process.stdin.flush()
+    while process.stdout.readline() not in ["Unknown node last_line\n", ""]:
+        pass
+
+    process.kill()
+    process.wait()
+
+
+def start_server(path, args=[]):
+    remove(path)
+    server = subprocess.Popen(["bin/main", "--serve", path] + args, stdout=subprocess.DEVNULL)
+    # the socket file appears before the server listens on it
+    for i in range(500):
+        try:
+            connect(path).close()
+            break
+        except OSError:
+            time.sleep(0.01)
+    return server
+
+
+def stop_server(server):
+    server.terminate()
+    server.wait()
+
+
+def connect(path):
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(path)
+    return client
+
+
+def receive_all(client):
+    chunks = []
+    while chunk := client.recv(1 << 16):
+        chunks.append(chunk)
+    client.close()
+    return b"".join(chunks).decode()
+
+
+def ask(path, commands):
+    client = connect(path)
+    client.sendall(("\n".join(commands) + "\n").encode())
+    client.shutdown(socket.SHUT_WR)
+    return receive_all(client)
+
+
+def resident_bytes(pid):
+    with open(f"/proc/{pid}/statm") as f:
+        return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+
+
+def remove(*paths):
+    for path in paths:
+        for i in [path, path + ".tmp"]:
+            if os.path.exists(i):
+                os.remove(i)
+
+
+failures = 0
+
+def check(name, expected, actual):
+    global failures
+    print('-'*20)
+    print("Testing " + name)
+    if expected == actual:
+        print("all good")
+    else:
+        failures += 1
+        print("Expected:\n")
+        print(expected)
+        print("Got:\n")
+        print(actual)
+        print("ERROR might be present")
+    print('-'*20 + "\n")
+
+
+# queries after LOAD print what they did before SAVE, a broken snapshot is refused and the graph is kept
+def test_snapshot():
+    nodes, commands = generate_graph(40, 120)
+    named, named_commands = generate_graph(10, 20, prefix="v")
+    nodes += named
+    commands += named_commands + [f"EDGE {nodes[0]} {named[0]} 7"]
+    queries = generate_queries(nodes)
+
+    path = "tests/snapshot.snap"
+    remove(path)
+    before = run(commands + queries + [f"SAVE {path}"])
+    check("snapshot round trip", before, run([f"LOAD {path}"] + queries))
+
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    # sections follow the 88-byte header (the last section's tail may be padding, which no checksum covers),
+    # the first one is mark offsets: a byte of them is flipped
+    header = 88
+    broken = "tests/snapshot_broken.snap"
+    for name, content in [("truncated snapshot", data[:len(data) - 12]),
+                          ("snapshot with a bad section checksum",
+                           data[:header + 8] + bytes([data[header + 8] ^ 1]) + data[header + 9:])]:
+        with open(broken, 'wb') as f:
+            f.write(content)
+
+        check(name, f"Corrupted snapshot {broken}\n" + before, run(commands + [f"LOAD {broken}"] + queries))
+
+    check("missing snapshot", f"Cannot read tests/missing.snap\n", run(["LOAD tests/missing.snap"]))
+    remove(path, broken)
+
+
+# the graph recovered from the log answers queries the way the graph it was logged from did
+def test_log():
+    nodes, commands = generate_graph(30, 80)
+    first = commands + generate_removals(nodes, commands)
+    more_nodes, more = generate_graph(10, 30, prefix="v")
+    second = more + [f"EDGE {nodes[0]} {more_nodes[0]} 3"] + generate_removals(more_nodes, more)
+    queries = generate_queries(nodes[:1] + more_nodes)
+    expected = run(first + second + queries)
+
+    # every record is committed as soon as it's applied, so none is lost with the process
+    path = "tests/wal.log"
+    remove(path, path + ".snap")
+    run_killed(first + ["CHECKPOINT"] + second, ["--log", path, "--log-records", "1"])
+    check("log recovery after a kill", expected, run(queries, ["--log", path]))
+
+    # a checkpoint interrupted before the log started over: the log continues the old snapshot,
+    # so it's ignored next to the new one
+    new_path = "tests/wal_new.log"
+    remove(path, path + ".snap", new_path, new_path + ".snap")
+    run(first + ["CHECKPOINT"] + second, ["--log", path])
+    run(first + second + ["CHECKPOINT"], ["--log", new_path])
+    shutil.copy(path, "tests/wal_old.log")
+    shutil.copy(path + ".snap", "tests/wal_old.log.snap")
+    shutil.copy(new_path + ".snap", path + ".snap")
+    check("checkpoint interrupted after the snapshot", expected, run(queries, ["--log", path]))
+
+    # interrupted while the snapshot was written: old snapshot and log are whole, the new one is a temporary file
+    shutil.copy("tests/wal_old.log", path)
+    shutil.copy("tests/wal_old.log.snap", path + ".snap")
+    with open(new_path + ".snap", 'rb') as f:
+        partial = f.read()
+    with open(path + ".snap.tmp", 'wb') as f:
+        f.write(partial[:len(partial) // 2])
+    check("checkpoint interrupted while writing the snapshot", expected, run(queries, ["--log", path]))
+
+    remove(path, path + ".snap", new_path, new_path + ".snap", "tests/wal_old.log", "tests/wal_old.log.snap")
+
+
+# once the log can't be written, mutations are refused; what was written before is recovered
+def test_log_failure():
+    path = "tests/wal_full.log"
+    remove(path, path + ".snap")
+
+    # the log can't grow past 1 KiB, writes beyond fail instead of killing the process
+    def limit():
+        resource.setrlimit(resource.RLIMIT_FSIZE, (1024, 1024))
+        signal.signal(signal.SIGXFSZ, signal.SIG_IGN)
+
+    commands = [f"NODE {i}" for i in range(200)] + ["COMPONENTS"]
+    output = subprocess.run(["bin/main", "--interactive", "--log", path, "--log-records", "1"],
+                            input="\n".join(commands) + "\n", capture_output=True, text=True,
+                            preexec_fn=limit, timeout=60).stdout
+
+    # the node whose record failed is in memory only, later ones are refused. every node is a component
+    refused = output.count("Log write failed")
+    kept = 200 - refused
+    check("log write failure", "Log write failed\n" * refused + "".join(f"{i} \n" for i in range(kept)),
+          output if refused else "no write failed")
+    check("recovery after a log write failure", "".join(f"{i} \n" for i in range(kept - 1)),
+          run(["COMPONENTS"], ["--log", path]))
+    remove(path, path + ".snap")
+
+
+# clients are answered as stdin is, one which sends more than it reads isn't read from meanwhile
+def test_server():
+    path = "tests/server.sock"
+    nodes, commands = generate_graph(30, 80)
+    queries = generate_queries(nodes)
+
+    server = start_server(path, ["--workers", "2"])
+    check("server answers like stdin", run(commands + queries), ask(path, commands + queries))
+
+    answers = [None] * 4
+    def query(i):
+        answers[i] = ask(path, queries)
+    threads = [threading.Thread(target=query, args=(i,)) for i in range(4)]
+    for i in threads:
+        i.start()
+    for i in threads:
+        i.join()
+    check("concurrent clients", [run(commands + queries)] * 4, answers)
+    stop_server(server)
+
+    # a client sends long lines and doesn't read its long responses: they fill the server's buffer, its lines
+    # wait for them and fill the queue, then the client isn't read from. lines are padded with a token
+    # the command loop skips
+    server = start_server(path)
+    nodes, commands = generate_graph(500, 1000)
+    ask(path, commands)
+    answer = ask(path, [f"BFS {nodes[0]}"])
+    line = (f"BFS {nodes[0]} " + "x" * 1000 + "\n").encode()
+    count = 16 * 1024
+    data = line * count
+
+    before = resident_bytes(server.pid)
+    flooding = connect(path)
+    flooding.setblocking(False)
+    accepted = 0
+    stalled = time.time()
+    while accepted < len(data) and time.time() - stalled < 1:
+        try:
+            accepted += flooding.send(data[accepted:accepted + (1 << 16)])
+            stalled = time.time()
+        except BlockingIOError:
+            time.sleep(0.01)
+    grown = resident_bytes(server.pid) - before
+
+    check("client which doesn't read is throttled", "throttled",
+          "throttled" if accepted < len(data) // 4 else f"{accepted} bytes were read")
+    check("throttled client's lines and responses are bounded", "bounded",
+          "bounded" if grown < 16 << 20 else f"server grew by {grown} bytes")
+    check("other clients are answered meanwhile", "true\n", ask(path, [f"REACH {nodes[0]} {nodes[0]}"]))
+
+    flooding.setblocking(True)
+    def send_rest():
+        flooding.sendall(data[accepted:])
+        flooding.shutdown(socket.SHUT_WR)
+    sender = threading.Thread(target=send_rest)
+    sender.start()
+    received = receive_all(flooding)
+    sender.join()
+    check("throttled client gets every answer", "all", "all" if received == answer * count else
+          f"{received.count(chr(10))} lines instead of {answer.count(chr(10)) * count}")
+
+    check("line over the limit is dropped", answer + "Line too long\n" + answer,
+          ask(path, [f"BFS {nodes[0]}", "x" * (2 << 20), f"BFS {nodes[0]}"]))
+    stop_server(server)
+    remove(path)
+
+
+# reads inside a transaction see the graph as it was at BEGIN, after COMMIT they see its changes
+def test_transactions():
+    nodes, commands = generate_graph(30, 80)
+    added, changes = generate_graph(8, 15, prefix="t")
+    changes += [f"EDGE {nodes[0]} {added[0]} 5", f"EDGE {added[1]} {nodes[1]} 5"]
+    changes += generate_removals(nodes, commands)
+    queries = generate_queries(nodes[:2] + added)
+    queries[0] = f"RPO_NUMBERING {nodes[0]}"
+    before = run(commands + queries)
+    after = run(commands + changes + queries)
+
+    # reads between mutations of a transaction, in bulk (piped) and line by line
+    mixed = commands + ["BEGIN"] + changes[:10] + queries + changes[10:] + queries + ["COMMIT"] + queries
+    for name, args in [("transaction", []), ("transaction with --interactive", ["--interactive"])]:
+        check(name, before * 2 + after, run(mixed, args))
+
+    # BEGIN and COMMIT on the line of mutations and reads
+    line = " ".join(["BEGIN"] + changes + queries + ["COMMIT"] + queries)
+    check("transaction on one line", before + after, run(commands + [line]))
+
+    # a transaction left open at exit never reaches the log
+    path = "tests/transaction.log"
+    remove(path, path + ".snap")
+    run(commands, ["--log", path])
+    check("open transaction at exit", before, run(["BEGIN"] + changes + queries, ["--log", path]))
+    check("open transaction is dropped", before, run(queries, ["--log", path]))
+    run(["BEGIN"] + changes + ["COMMIT"], ["--log", path])
+    check("committed transaction is logged", after, run(queries, ["--log", path]))
+    remove(path, path + ".snap")
+
+
+# cached results are dropped by a mutation and evicted to stay within --cache-bytes
+def test_cache():
+    nodes, commands = generate_graph(50, 150)
+    src, dst = nodes[:2]
+    commands.append(f"EDGE {src} {dst} 1")
+    queries = [f"BFS {src}", f"DIJKSTRA {src}", f"MAX FLOW {src} {dst}", f"TARJAN {src}", "COMPONENTS"]
+    stats = lambda hits, misses, entries, size: f"hits {hits} misses {misses} entries {entries} bytes {size}\n"
+
+    results = {query: run(commands + [query], ["--cache-bytes", "0"]) for query in queries}
+    cost = lambda query, result: len(query) + len(result) + 96
+
+    # answers are computed again after a mutation and replace the old ones. the direct edge
+    # is saturated by any maximal flow, so at least MAX FLOW's answer changes
+    removal = f"REMOVE EDGE {src} {dst}"
+    mutated = {query: run(commands + [removal, query], ["--cache-bytes", "0"]) for query in queries}
+    check("mutation invalidates cached results",
+          "".join(results.values()) * 2 + "".join(mutated.values()) +
+          stats(len(queries), len(queries) * 2, len(queries), sum(cost(*i) for i in mutated.items())),
+          run(commands + queries + queries + [removal] + queries + ["CACHE_STATS"]))
+
+    # room for any two entries: the least recently used one goes
+    bfs, dijkstra, tarjan = queries[0], queries[1], queries[3]
+    cost_of = lambda query: cost(query, results[query])
+    limit = max(cost_of(bfs) + cost_of(dijkstra), cost_of(bfs) + cost_of(tarjan), cost_of(dijkstra) + cost_of(tarjan))
+    order = [bfs, dijkstra, tarjan, tarjan, bfs]
+    check("least recently used result is evicted",
+          "".join(results[query] for query in order) + stats(1, 4, 2, cost_of(tarjan) + cost_of(bfs)),
+          run(commands + order + ["CACHE_STATS"], ["--cache-bytes", str(limit)]))
+
+    check("--cache-bytes 0", "".join(results[query] for query in queries) * 2 + stats(0, len(queries) * 2, 0, 0),
+          run(commands + queries + queries + ["CACHE_STATS"], ["--cache-bytes", "0"]))
+
+
+# a fork's MAX FLOW is the graph's one after the same edits, the graph itself isn't changed by them
+def test_forks():
+    nodes, commands = generate_graph(30, 90)
+    src, sink = nodes[:2]
+    edges = [cmd.split()[1:3] for cmd in commands if cmd.startswith("EDGE")]
+    edits = [f"EDGE {a} {b} {random.randint(1, 100)}" for a, b in random.sample(list(zip(nodes, nodes[1:])), 5)]
+    edits += [f"REMOVE EDGE {a} {b}" for a, b in random.sample(edges, 10)]
+    flow = f"MAX FLOW {src} {sink}"
+
+    graph_flow = run(commands + [flow])
+    fork_flow = run(commands + ["BEGIN"] + edits + ["COMMIT", flow])
+    scenario = ["FORK f"] + [f"IN f {edit}" for edit in edits] + [flow, f"IN f {flow}", "DROP f", f"IN f {flow}"]
+    check("fork against a transaction", graph_flow + fork_flow + "Unknown fork f\n", run(commands + scenario))
+
+    # unsupported commands in a fork are refused with the rest of their line, the graph stays as it was
+    queries = generate_queries(nodes)
+    unsupported = ["FORK f", f"IN f REMOVE NODE {src}", "IN f NODE c", f"IN f EDGE {src} c 1",
+                   f"IN f BFS {src} NODE d EDGE {src} d 1"]
+    refused = "Unsupported in forks REMOVE\nUnsupported in forks NODE\nUnknown node c\nUnsupported in forks BFS\n"
+    check("unsupported commands in a fork", refused + run(commands + queries), run(commands + unsupported + queries))
+
+    # forks of the server's pinned versions outlive later changes to the graph
+    path = "tests/forks.sock"
+    server = start_server(path)
+    ask(path, commands)
+    answers = [ask(path, [line]) for line in scenario[:-2]]
+    ask(path, [f"REMOVE NODE {sink}"])
+    answers.append(ask(path, [f"IN f {flow}"]))
+    answers += [ask(path, [line]) for line in scenario[-2:]]
+    check("fork in server mode", graph_flow + fork_flow * 2 + "Unknown fork f\n", "".join(answers))
+    stop_server(server)
+    remove(path)
+
+
+# REORDER renumbers nodes only: DFS-ordered answers and flows stay, BFS and DIJKSTRA list the same lines
+# in the new order of ids
+def test_reorder():
+    nodes, commands = generate_graph(60, 150)
+    commands += generate_removals(nodes, commands)
+    src, sink = nodes[:2]
+    same = [f"RPO_NUMBERING {src}", f"TARJAN {src}", f"MAX FLOW {src} {sink}"]
+    reordered = [f"BFS {src}", f"DIJKSTRA {src}"]
+    expected = run(commands + same) + "".join(sorted(run(commands + reordered).splitlines(True)))
+
+    for strategy in ["RCM", "BFS", "DEGREE"]:
+        output = run(commands + [f"REORDER {strategy}"] + same)
+        output += "".join(sorted(run(commands + [f"REORDER {strategy}"] + reordered).splitlines(True)))
+        check(f"REORDER {strategy}", expected, output)
+
+
+# dense graphs are queried on bit matrices (common/dense.hpp), --dense 0 keeps them on edge sets:
+# a random graph, mostly one large SCC, and a DAG of small cycles, many components apart
+def test_dense():
+    nodes, commands = generate_graph(100, 1500)
+    commands += generate_removals(nodes, commands, 0.02)
+
+    cycles = [f"c{i}" for i in range(96)]
+    layered = [f"NODE {node}" for node in cycles]
+    for i in range(0, len(cycles), 3):
+        layered += [f"EDGE {cycles[i]} {cycles[i + 1]} 1", f"EDGE {cycles[i + 1]} {cycles[i + 2]} 2",
+                    f"EDGE {cycles[i + 2]} {cycles[i]} 3"]
+    for i in range(len(cycles)):
+        for j in range(i + 3 - i % 3, len(cycles)):
+            if random.random() < 0.4:
+                layered.append(f"EDGE {cycles[i]} {cycles[j]} {random.randint(1, 100)}")
+
+    for name, graph, roots in [("random", commands, nodes[:3]), ("DAG of cycles", layered, cycles[:2] + cycles[40:41])]:
+        queries = ["COMPONENTS"]
+        for root in roots:
+            queries += [f"TARJAN {root}", f"RPO_NUMBERING {root}", f"BFS {root}", f"DIJKSTRA {root}"]
+        check(f"dense {name}", run(graph + queries, ["--dense", "0"]), run(graph + queries))
+
+
+# --external answers BFS, RPO_NUMBERING and TARJAN right from the snapshot file as they're answered after LOAD
+def test_external():
+    nodes, commands = generate_graph(50, 200)
+    named, named_commands = generate_graph(10, 20, prefix="v")
+    nodes += named
+    commands += named_commands + [f"EDGE {nodes[0]} {named[0]} 7"]
+    commands += generate_removals(nodes, commands)
+
+    queries = []
+    for root in [nodes[0]] + random.sample(nodes[1:], 3):
+        queries += [f"BFS {root}", f"RPO_NUMBERING {root}", f"TARJAN {root}"]
+
+    path = "tests/external.snap"
+    remove(path)
+    run(commands + [f"SAVE {path}"])
+    check("external snapshot", run([f"LOAD {path}"] + queries), run(queries, ["--external", path]))
+
+    short = "tests/external_short.snap"
+    with open(short, 'wb') as f:
+        f.write(b"GRAPH")
+    check("short external snapshot", f"Corrupted snapshot {short}\n", run(queries, ["--external", short]))
+    check("missing external snapshot", "Cannot read tests/missing.snap\n", run(queries, ["--external", "tests/missing.snap"]))
+    remove(path, short)
+
+
+# SHARDED_BFS and SHARDED_SSSP print what BFS and DIJKSTRA do; a mutation between queries makes
+# the workers be forked again for the new version
+def test_sharded():
+    nodes, commands = generate_graph(60, 240)
+    mutations = generate_removals(nodes, commands, 0.2) + ["NODE extra", f"EDGE {nodes[0]} extra 3",
+                                                           f"EDGE extra {nodes[1]} 1"]
+
+    roots = [nodes[0]] + random.sample(nodes[1:], 2)
+    queries = lambda bfs, sssp: [f"{name} {root}" for root in roots for name in [bfs, sssp]]
+
+    expected = run(commands + queries("BFS", "DIJKSTRA") + mutations + queries("BFS", "DIJKSTRA"))
+    sharded = queries("SHARDED_BFS", "SHARDED_SSSP")
+    check("sharded queries", expected, run(commands + sharded + mutations + sharded, ["--shards", "3"]))
+
+
+# marks which are plain numbers of at most 18 digits are kept as numbers, the rest as strings
+# (common/marks.hpp): a graph mixing them answers as the same graph with every mark renamed to
+# a string does, and its marks survive SAVE/LOAD and the log
+def test_marks():
+    marks = [str(100 + i) for i in range(30)] + ["0", "7", "007", "-1", "-0", "+5", "1e3", "x", "7a",
+             "123456789012345678", "999999999999999999", "1234567890123456789", "9999999999999999999",
+             "12345678901234567890", "18446744073709551616"]
+    names = [f"m{i}" for i in range(len(marks))]
+    edges = [(a, b, random.randint(1, 100)) for a, b in random.sample(list(permutations(range(len(marks)), 2)), 200)]
+    removed = [i for i in range(1, len(marks)) if random.random() < 0.1]
+    roots = [0] + random.sample(range(30, len(marks)), 3)
+
+    def generate(marks):
+        commands = [f"NODE {mark}" for mark in marks] + [f"EDGE {marks[a]} {marks[b]} {w}" for a, b, w in edges]
+        return commands + [f"REMOVE NODE {marks[i]}" for i in removed]
+
+    named_queries = generate_queries([names[i] for i in roots]) + [f"BFS {name}" for name in names[30:]]
+    to_mark = lambda text: re.sub(r"\bm(\d+)\b", lambda match: marks[int(match.group(1))], text)
+    commands, queries = generate(marks), [to_mark(query) for query in named_queries]
+    expected = to_mark(run(generate(names) + named_queries))
+    check("numeric and string marks", expected, run(commands + queries))
+
+    path = "tests/marks.snap"
+    remove(path)
+    run(commands + [f"SAVE {path}"])
+    check("marks after SAVE and LOAD", expected, run([f"LOAD {path}"] + queries))
+
+    log = "tests/marks.log"
+    remove(log, log + ".snap")
+    run_killed(commands, ["--log", log, "--log-records", "1"])
+    check("marks recovered from the log", expected, run(queries, ["--log", log]))
+    remove(path, log, log + ".snap")
+
+
+# REMOVE NODES takes its list as a set: duplicates are skipped, unknown nodes reported once, and the
+# graph is the one removing every node by itself gives, also once it's replayed from the log
+def test_remove_nodes():
+    nodes, commands = generate_graph(40, 150)
+    targets = random.sample(nodes[1:], 8)
+    listed = targets + targets[:3] + ["zz1", "zz2", "zz1"]
+    random.shuffle(listed)
+    queries = generate_queries(nodes[:1] + random.sample(nodes[1:], 3))
+
+    one_by_one = [f"REMOVE NODE {node}" for node in dict.fromkeys(listed)]
+    expected = run(commands + one_by_one + queries)
+    check("REMOVE NODES with duplicates", expected, run(commands + [f"REMOVE NODES {' '.join(listed)}"] + queries))
+    check("REMOVE NODES with duplicates, interactive", expected,
+          run(commands + [f"REMOVE NODES {' '.join(listed)}"] + queries, ["--interactive"]))
+
+    # a REMOVE NODES line and single removals after it form one run of removal records in the log
+    more = random.sample([node for node in nodes[1:] if node not in targets], 4)
+    path = "tests/remove_nodes.log"
+    remove(path, path + ".snap")
+    run_killed(commands + [f"REMOVE NODES {' '.join(listed)}"] + [f"REMOVE NODE {node}" for node in more],
+               ["--log", path, "--log-records", "1"])
+    applied = one_by_one + [f"REMOVE NODE {node}" for node in more]
+    check("REMOVE NODES replayed from the log", run([line for line in commands + applied if "zz" not in line] + queries),
+          run(queries, ["--log", path]))
+    remove(path, path + ".snap")
+
+
+# COMPONENTS formats components in parallel (forEachComponent in 1.1/components.hpp): many components of
+# uneven sizes print the same with any count of threads
+def test_components():
+    commands = []
+    for i in range(40):
+        nodes, piece = generate_graph(random.randint(1, 30), random.randint(0, 60), prefix=f"p{i}_")
+        commands += piece
+    commands += [f"NODE {i}" for i in range(50)] + [f"EDGE {i} {i + 1} 1" for i in range(0, 48, 3)]
+    random.shuffle(commands)
+    commands.sort(key=lambda cmd: not cmd.startswith("NODE"))
+
+    expected = run(commands + ["COMPONENTS"], ["--threads", "1"])
+    for threads in ["2", "4", "7"]:
+        check(f"COMPONENTS with {threads} threads", expected, run(commands + ["COMPONENTS"], ["--threads", threads]))
+
+
+os.makedirs("tests", exist_ok=True)
+test_snapshot()
+test_log()
+test_log_failure()
+test_server()
+test_transactions()
+test_cache()
+test_forks()
+test_reorder()
+test_dense()
+test_external()
+test_sharded()
+test_marks()
+test_remove_nodes()
+test_components()
+
+print(f"{failures} failed" if failures else "all passed")
+exit(1 if failures else 0)